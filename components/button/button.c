@@ -1,61 +1,76 @@
 // button.c
 
 #include "button.h"
-#include "dht11_task.hpp"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
-#include "lcd_task.h"
+#include "freertos/task.h"
+#include "keyevent.h"
 
 static const char* TAG = "BUTTON_DRIVER";
 
-static volatile TickType_t last_isr_tick = 0;
-
 static SemaphoreHandle_t xSignaler = NULL;
 
-static void IRAM_ATTR gpio_isr_handler(void* arg) {
-    TickType_t current_tick = xTaskGetTickCountFromISR();
-
-    if (current_tick - last_isr_tick > pdMS_TO_TICKS(DEBOUNCE_TIME_MS)) {
-        last_isr_tick = current_tick;
+static const key_engine_config_t button_key_config = {
+    .long_press_ms = BUTTON_LONG_PRESS_MS,
+};
 
-        BaseType_t higher_priority_task = pdFALSE;
-        xSemaphoreGiveFromISR(xSignaler, &higher_priority_task);
+static void IRAM_ATTR gpio_isr_handler(void* arg) {
+    BaseType_t higher_priority_task = pdFALSE;
+    xSemaphoreGiveFromISR(xSignaler, &higher_priority_task);
 
-        if (higher_priority_task == pdTRUE) {
-            portYIELD_FROM_ISR();
-        }
+    if (higher_priority_task == pdTRUE) {
+        portYIELD_FROM_ISR();
     }
 }
 
-static void button_task_init() {
+static esp_err_t button_task_init() {
     gpio_reset_pin(BUTTON_GPIO);
     gpio_set_direction(BUTTON_GPIO, GPIO_MODE_INPUT);
-    gpio_set_intr_type(BUTTON_GPIO, GPIO_INTR_NEGEDGE);
+    gpio_set_intr_type(BUTTON_GPIO, GPIO_INTR_ANYEDGE);
     gpio_set_pull_mode(BUTTON_GPIO, GPIO_PULLUP_DISABLE);
     xSignaler = xSemaphoreCreateBinary();
     if (xSignaler == NULL) {
-        ESP_LOGE(TAG, "FAILED TO CREATE SEMAPHORE: EXPECT UNSTABLE BEHAVIOR");
-        return;
+        ESP_LOGE(TAG, "FAILED TO CREATE SEMAPHORE");
+        return ESP_ERR_NO_MEM;
     }
     esp_err_t isr_service_result = gpio_install_isr_service(0);
     if (isr_service_result != ESP_OK && isr_service_result != ESP_ERR_INVALID_STATE) {
         ESP_LOGE(TAG, "Failed to install ISR service: %s", esp_err_to_name(isr_service_result));
-        return;
+        return isr_service_result;
     }
     ESP_ERROR_CHECK(gpio_isr_handler_add(BUTTON_GPIO, gpio_isr_handler, NULL));
+    return ESP_OK;
 }
 
 void button_press_task(void* pvParameters) {
     (void)pvParameters;
 
-    button_task_init();
+    if (button_task_init() != ESP_OK) {
+        vTaskDelete(NULL);
+        return;
+    }
+
+    key_engine_t keys;
+    key_engine_init(&keys, KEY_SOURCE_BUTTON, &button_key_config);
+
+    TickType_t wait = portMAX_DELAY;
 
     while (1) {
-        if (xSemaphoreTake(xSignaler, portMAX_DELAY) == pdTRUE) {
-            ESP_LOGI(TAG, "BUTTON PRESSED");
-            lcd_cycle_mode();
+        if (xSemaphoreTake(xSignaler, wait) == pdTRUE) {
+            // Let the contacts settle, then go by the level rather than by the edge
+            vTaskDelay(pdMS_TO_TICKS(DEBOUNCE_TIME_MS));
+            xSemaphoreTake(xSignaler, 0);
+
+            bool pressed = gpio_get_level(BUTTON_GPIO) == 0;
+            if (pressed && !key_engine_is_down(&keys, BUTTON_KEY_CODE)) {
+                ESP_LOGI(TAG, "BUTTON PRESSED");
+                key_engine_press(&keys, BUTTON_KEY_CODE);
+            } else if (!pressed) {
+                key_engine_release(&keys);
+            }
         }
+        wait = key_engine_poll(&keys);
     }
-}
\ No newline at end of file
+}
@@ -3,6 +3,10 @@
 #pragma once
 
 #define BUTTON_GPIO GPIO_NUM_18
-#define DEBOUNCE_TIME_MS 200
+#define DEBOUNCE_TIME_MS 30
+
+// The button reports as a single key, it releases on its own edge so needs no timeout
+#define BUTTON_KEY_CODE 0
+#define BUTTON_LONG_PRESS_MS 1000
 
 void button_press_task(void* pvParameters);
@@ -1,21 +1,118 @@
 // dht11.c
 
-#include "dht11.h"     
+#include "dht11.h"
 #include <stdbool.h>
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "rom/ets_sys.h"
 
 static const char* TAG = "DHT11_DRIVER";
 
-esp_err_t read_dht_data(float* temperature, float* humidity, bool suppressLogErrors) {
-    uint8_t data[5] = {0, 0, 0, 0, 0};
-    esp_err_t ret   = ESP_OK;
+#if DHT11_CAPTURE_BACKEND == DHT11_BACKEND_EDGE_ISR
+
+static dht11_edge_t s_edges[DHT11_MAX_EDGES];
+static volatile size_t s_num_edges = 0;
+static volatile size_t s_num_highs = 0;
+
+static SemaphoreHandle_t s_frame_done   = NULL;
+static esp_timer_handle_t s_start_timer = NULL;
+
+static void IRAM_ATTR _dht11_edge_isr_handler(void* arg) {
+    size_t idx = s_num_edges;
+    if (idx >= DHT11_MAX_EDGES) {
+        return;
+    }
+
+    s_edges[idx].time_us = (uint32_t)esp_timer_get_time();
+    s_edges[idx].level   = gpio_get_level(DHT11_PIN);
+    s_num_edges          = idx + 1;
+
+    if (idx > 0 && s_edges[idx - 1].level == 1 && s_edges[idx].level == 0) {
+        s_num_highs++;
+        if (s_num_highs == DHT11_FRAME_HIGH_PULSES) {
+            BaseType_t higher_priority_task = pdFALSE;
+            xSemaphoreGiveFromISR(s_frame_done, &higher_priority_task);
+
+            if (higher_priority_task == pdTRUE) {
+                portYIELD_FROM_ISR();
+            }
+        }
+    }
+}
+
+// Runs from the esp_timer task once the start pulse has been held long enough
+static void _dht11_start_pulse_done(void* arg) {
+    gpio_intr_enable(DHT11_PIN);
+    gpio_set_direction(DHT11_PIN, GPIO_MODE_INPUT);
+}
+
+static esp_err_t _dht11_capture_init(void) {
+    s_frame_done = xSemaphoreCreateBinary();
+    if (s_frame_done == NULL) {
+        ESP_LOGE(TAG, "FAILED TO CREATE SEMAPHORE");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = _dht11_start_pulse_done,
+        .name     = "dht11_start",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_start_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create start pulse timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
 
+    gpio_set_intr_type(DHT11_PIN, GPIO_INTR_ANYEDGE);
+    gpio_intr_disable(DHT11_PIN);
+
+    esp_err_t isr_service_result = gpio_install_isr_service(0);
+    if (isr_service_result != ESP_OK && isr_service_result != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to install ISR service: %s", esp_err_to_name(isr_service_result));
+        return isr_service_result;
+    }
+
+    return gpio_isr_handler_add(DHT11_PIN, _dht11_edge_isr_handler, NULL);
+}
+
+static esp_err_t _dht11_capture_frame(uint8_t data[5]) {
+    if (s_start_timer == NULL) {
+        esp_err_t ret = _dht11_capture_init();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    xSemaphoreTake(s_frame_done, 0);
+    s_num_edges = 0;
+    s_num_highs = 0;
+
+    // 1. Hold the line low, the timer hands it back to the sensor without spinning
+    gpio_set_direction(DHT11_PIN, GPIO_MODE_OUTPUT);
+    gpio_set_level(DHT11_PIN, 0);
+    esp_timer_start_once(s_start_timer, DHT11_START_PULSE_US);
+
+    // 2. Sleep until the ISR has timestamped the whole frame
+    TickType_t wait = pdMS_TO_TICKS(DHT11_START_PULSE_US / 1000 + DHT11_FRAME_TIMEOUT_MS);
+    xSemaphoreTake(s_frame_done, wait > 0 ? wait : 1);
+
+    esp_timer_stop(s_start_timer);
+    gpio_intr_disable(DHT11_PIN);
+    gpio_set_direction(DHT11_PIN, GPIO_MODE_INPUT);
+
+    // 3. Decode afterwards, a capture that timed out is rejected here if bits are missing
+    return dht11_decode_edges(s_edges, s_num_edges, data);
+}
+
+#else
+
+static esp_err_t _dht11_capture_frame(uint8_t data[5]) {
     // 1. Send start signal
     gpio_set_direction(DHT11_PIN, GPIO_MODE_OUTPUT);
     gpio_set_level(DHT11_PIN, 0);
-    esp_rom_delay_us(20000);
+    esp_rom_delay_us(DHT11_START_PULSE_US);
     gpio_set_level(DHT11_PIN, 1);
     esp_rom_delay_us(40);
     gpio_set_direction(DHT11_PIN, GPIO_MODE_INPUT);
@@ -25,77 +122,73 @@ esp_err_t read_dht_data(float* temperature, float* humidity, bool suppressLogErr
 
     while (gpio_get_level(DHT11_PIN) == 1) {
         if (esp_timer_get_time() - start_time > 100) {
-            ret = ESP_FAIL;
-            goto exit_critical;
+            return ESP_ERR_TIMEOUT;
         }
     }
 
     start_time = esp_timer_get_time();
     while (gpio_get_level(DHT11_PIN) == 0) {
         if (esp_timer_get_time() - start_time > 100) {
-            ret = ESP_FAIL;
-            goto exit_critical;
+            return ESP_ERR_TIMEOUT;
         }
     }
 
     start_time = esp_timer_get_time();
     while (gpio_get_level(DHT11_PIN) == 1) {
         if (esp_timer_get_time() - start_time > 100) {
-            ret = ESP_FAIL;
-            goto exit_critical;
+            return ESP_ERR_TIMEOUT;
         }
     }
 
     // 3. Data Transmission
     for (uint8_t i = 0; i < 5; i++) {
+        data[i] = 0;
         for (uint8_t j = 0; j < 8; j++) {
             start_time = esp_timer_get_time();
             while (gpio_get_level(DHT11_PIN) == 0) {
                 if (esp_timer_get_time() - start_time > 70) {
-                    ret = ESP_FAIL;
-                    goto exit_critical;
+                    return ESP_ERR_TIMEOUT;
                 }
             }
             start_time = esp_timer_get_time();
             while (gpio_get_level(DHT11_PIN) == 1) {
-                if (esp_timer_get_time() - start_time > 120) {
-                    ret = ESP_FAIL;
-                    goto exit_critical;
+                if (esp_timer_get_time() - start_time > DHT11_BIT_MAX_HIGH_US) {
+                    return ESP_ERR_TIMEOUT;
                 }
             }
 
             uint64_t pulse_duration = esp_timer_get_time() - start_time;
             data[i] <<= 1;
-            if (pulse_duration > 40) {
+            if (pulse_duration > DHT11_BIT_ONE_THRESHOLD_US) {
                 data[i] |= 1;
             }
         }
     }
 
     // 4. Checksum
-    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-        ret = ESP_ERR_INVALID_CRC;
-    } else {
-        *humidity    = (float)data[0] + (float)data[1] / 10.0f;
-        *temperature = (float)data[2] + (float)data[3] / 10.0f;
+    return dht11_check_frame(data);
+}
 
-        ret = ESP_OK;
-    }
+#endif
 
-exit_critical:
+esp_err_t read_dht_data(float* temperature, float* humidity, bool suppressLogErrors) {
+    uint8_t data[5] = {0, 0, 0, 0, 0};
+    esp_err_t ret   = _dht11_capture_frame(data);
 
-    if (ret != ESP_OK && !suppressLogErrors) {
-        if (ret == ESP_ERR_INVALID_CRC) {
-            ESP_LOGE(TAG, "CHECKSUM FAILED");
-            return ESP_FAIL;
-        } else {
-            ESP_LOGE(TAG, "DHT timing error: %s", esp_err_to_name(ret));
-            return ESP_FAIL;
+    if (ret != ESP_OK) {
+        if (!suppressLogErrors) {
+            if (ret == ESP_ERR_INVALID_CRC) {
+                ESP_LOGE(TAG, "CHECKSUM FAILED");
+            } else {
+                ESP_LOGE(TAG, "DHT timing error: %s", esp_err_to_name(ret));
+            }
         }
-    } else {
-        ESP_LOGI(TAG, "This round of data is VALID");
-        return ESP_OK;
+        return ESP_FAIL;
     }
 
+    *humidity    = (float)data[0] + (float)data[1] / 10.0f;
+    *temperature = (float)data[2] + (float)data[3] / 10.0f;
+
+    ESP_LOGI(TAG, "This round of data is VALID");
     return ESP_OK;
-}
\ No newline at end of file
+}
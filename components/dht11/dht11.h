@@ -2,11 +2,27 @@
 
 #pragma once
 
-#include "driver/gpio.h" 
-#include "esp_err.h"     
+#include "dht11_decode.h"
+#include "driver/gpio.h"
+#include "esp_err.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // DHT11 Pin Definition
 #define DHT11_PIN GPIO_NUM_4
 
-esp_err_t read_dht_data(float* temperature, float* humidity, bool suppressLogErrors);
\ No newline at end of file
+// Capture backends, pick one at build time through DHT11_CAPTURE_BACKEND
+#define DHT11_BACKEND_BITBANG  0
+#define DHT11_BACKEND_EDGE_ISR 1
+
+#ifndef DHT11_CAPTURE_BACKEND
+#define DHT11_CAPTURE_BACKEND DHT11_BACKEND_EDGE_ISR
+#endif
+
+#define DHT11_START_PULSE_US    20000
+#define DHT11_FRAME_TIMEOUT_MS  10
+#define DHT11_FRAME_HIGH_PULSES 42
+#define DHT11_MAX_EDGES         96
+
+esp_err_t read_dht_data(float* temperature, float* humidity, bool suppressLogErrors);
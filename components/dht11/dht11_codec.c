@@ -0,0 +1,104 @@
+// dht11_codec.c
+
+#include "dht11_codec.h"
+#include <math.h>
+#include <string.h>
+
+static uint32_t _zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t _unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static size_t _put_varint(uint8_t* out, uint32_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+static bool _get_varint(dht11_codec_decoder_t* dec, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (dec->pos >= dec->len) {
+            return false;
+        }
+        uint8_t byte = dec->buf[dec->pos++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static dht11_codec_sample_t _quantize(const dht11_reading_t* reading) {
+    dht11_codec_sample_t sample = {
+        .timestamp         = (uint32_t)reading->timestamp,
+        .temperature_centi = (int32_t)lroundf(reading->temperature * 100.0f),
+        .humidity_deci     = (int32_t)lroundf(reading->humidity * 10.0f),
+    };
+    return sample;
+}
+
+void dht11_codec_encoder_init(dht11_codec_encoder_t* enc, uint8_t* buf, size_t capacity) {
+    memset(enc, 0, sizeof(*enc));
+    enc->buf      = buf;
+    enc->capacity = capacity;
+}
+
+bool dht11_codec_encode(dht11_codec_encoder_t* enc, const dht11_reading_t* reading) {
+    dht11_codec_sample_t sample = _quantize(reading);
+    dht11_codec_sample_t base   = (enc->count == 0) ? (dht11_codec_sample_t){0, 0, 0} : enc->last;
+
+    uint8_t encoded[DHT11_CODEC_MAX_SAMPLE_SIZE];
+    size_t len = 0;
+    len += _put_varint(encoded + len, _zigzag((int32_t)(sample.timestamp - base.timestamp)));
+    len += _put_varint(encoded + len, _zigzag(sample.temperature_centi - base.temperature_centi));
+    len += _put_varint(encoded + len, _zigzag(sample.humidity_deci - base.humidity_deci));
+
+    if (enc->len + len > enc->capacity) {
+        return false;
+    }
+
+    memcpy(enc->buf + enc->len, encoded, len);
+    enc->len += len;
+    enc->count++;
+    enc->last = sample;
+    return true;
+}
+
+void dht11_codec_decoder_init(dht11_codec_decoder_t* dec, const uint8_t* buf, size_t len, uint32_t count) {
+    memset(dec, 0, sizeof(*dec));
+    dec->buf       = buf;
+    dec->len       = len;
+    dec->remaining = count;
+}
+
+bool dht11_codec_decode(dht11_codec_decoder_t* dec, dht11_reading_t* out) {
+    if (dec->remaining == 0) {
+        return false;
+    }
+
+    uint32_t dt, dtemp, dhum;
+    if (!_get_varint(dec, &dt) || !_get_varint(dec, &dtemp) || !_get_varint(dec, &dhum)) {
+        dec->remaining = 0;
+        return false;
+    }
+
+    dec->last.timestamp += (uint32_t)_unzigzag(dt);
+    dec->last.temperature_centi += _unzigzag(dtemp);
+    dec->last.humidity_deci += _unzigzag(dhum);
+    dec->remaining--;
+
+    out->timestamp   = (time_t)dec->last.timestamp;
+    out->temperature = dec->last.temperature_centi / 100.0f;
+    out->humidity    = dec->last.humidity_deci / 10.0f;
+    return true;
+}
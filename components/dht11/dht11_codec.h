@@ -0,0 +1,51 @@
+// dht11_codec.h
+
+#pragma once
+
+#include "dht11_reading.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Worst case for one sample, three 5-byte varints
+#define DHT11_CODEC_MAX_SAMPLE_SIZE 15
+
+// Readings are quantized to what the sensor can resolve (hundredths of a degree F after
+// conversion, tenths of a percent RH) and stored as zigzag varint deltas from the previous
+// sample, so a steady one-minute series costs about 3 bytes per reading instead of 16.
+// The first sample of every buffer is stored in full, so each buffer decodes on its own.
+typedef struct {
+    uint32_t timestamp;
+    int32_t temperature_centi;
+    int32_t humidity_deci;
+} dht11_codec_sample_t;
+
+typedef struct {
+    uint8_t* buf;
+    size_t capacity;
+    size_t len;
+    uint32_t count;
+    dht11_codec_sample_t last;
+} dht11_codec_encoder_t;
+
+typedef struct {
+    const uint8_t* buf;
+    size_t len;
+    size_t pos;
+    uint32_t remaining;
+    dht11_codec_sample_t last;
+} dht11_codec_decoder_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void dht11_codec_encoder_init(dht11_codec_encoder_t* enc, uint8_t* buf, size_t capacity);
+bool dht11_codec_encode(dht11_codec_encoder_t* enc, const dht11_reading_t* reading);
+
+void dht11_codec_decoder_init(dht11_codec_decoder_t* dec, const uint8_t* buf, size_t len, uint32_t count);
+bool dht11_codec_decode(dht11_codec_decoder_t* dec, dht11_reading_t* out);
+
+#ifdef __cplusplus
+}
+#endif
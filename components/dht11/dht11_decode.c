@@ -0,0 +1,56 @@
+// dht11_decode.c
+
+#include "dht11_decode.h"
+
+esp_err_t dht11_check_frame(const uint8_t data[5]) {
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+// Decodes a captured frame. Only complete high pulses (rising then falling edge) carry
+// information, and the last DHT11_FRAME_BITS of them are the data bits, so a missed
+// release edge or sensor response at the start of the capture doesn't shift the frame.
+esp_err_t dht11_decode_edges(const dht11_edge_t* edges, size_t num_edges, uint8_t data[5]) {
+    size_t num_highs = 0;
+    for (size_t i = 1; i < num_edges; i++) {
+        if (edges[i - 1].level == 1 && edges[i].level == 0) {
+            num_highs++;
+        }
+    }
+
+    if (num_highs < DHT11_FRAME_BITS) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    size_t skip = num_highs - DHT11_FRAME_BITS;
+    size_t bit  = 0;
+
+    for (int i = 0; i < 5; i++) {
+        data[i] = 0;
+    }
+
+    for (size_t i = 1; i < num_edges; i++) {
+        if (edges[i - 1].level != 1 || edges[i].level != 0) {
+            continue;
+        }
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+
+        uint32_t pulse_duration = edges[i].time_us - edges[i - 1].time_us;
+        if (pulse_duration > DHT11_BIT_MAX_HIGH_US) {
+            return ESP_ERR_TIMEOUT;
+        }
+
+        data[bit / 8] <<= 1;
+        if (pulse_duration > DHT11_BIT_ONE_THRESHOLD_US) {
+            data[bit / 8] |= 1;
+        }
+        bit++;
+    }
+
+    return dht11_check_frame(data);
+}
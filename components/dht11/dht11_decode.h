@@ -0,0 +1,19 @@
+// dht11_decode.h
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHT11_FRAME_BITS           40
+#define DHT11_BIT_ONE_THRESHOLD_US 40
+#define DHT11_BIT_MAX_HIGH_US      120
+
+typedef struct {
+    uint32_t time_us;
+    uint8_t level;
+} dht11_edge_t;
+
+esp_err_t dht11_check_frame(const uint8_t data[5]);
+esp_err_t dht11_decode_edges(const dht11_edge_t* edges, size_t num_edges, uint8_t data[5]);
@@ -0,0 +1,11 @@
+// dht11_reading.h
+
+#pragma once
+
+#include <time.h>
+
+typedef struct {
+    float temperature;
+    float humidity;
+    time_t timestamp;
+} dht11_reading_t;
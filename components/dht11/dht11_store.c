@@ -0,0 +1,393 @@
+// dht11_store.c
+
+#include "dht11_store.h"
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "esp_partition.h"
+
+static const char* TAG = "DHT11_STORE";
+#else
+#define ESP_LOGI(tag, ...)
+#define ESP_LOGW(tag, ...)
+#endif
+
+static uint16_t _dht11_store_crc16(const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint16_t crc         = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)bytes[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static size_t _sector_offset(uint32_t sector) {
+    return (size_t)sector * DHT11_STORE_SECTOR_SIZE;
+}
+
+static size_t _block_offset(uint32_t sector, uint32_t slot) {
+    return _sector_offset(sector) + sizeof(dht11_store_header_t) + (size_t)slot * sizeof(dht11_store_block_t);
+}
+
+static uint32_t _sector_for_seq(const dht11_store_t* store, uint32_t seq) {
+    uint32_t back = (store->head_seq - seq) % store->num_sectors;
+    return (store->head_sector + store->num_sectors - back) % store->num_sectors;
+}
+
+static bool _is_erased(const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        if (bytes[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool _read_header(const dht11_store_t* store, uint32_t sector, dht11_store_header_t* header) {
+    if (store->flash.read(store->flash.ctx, _sector_offset(sector), header, sizeof(*header)) != ESP_OK) {
+        return false;
+    }
+    return header->magic == DHT11_STORE_MAGIC &&
+           header->version == DHT11_STORE_VERSION &&
+           header->block_size == sizeof(dht11_store_block_t) &&
+           header->crc == _dht11_store_crc16(header, offsetof(dht11_store_header_t, crc));
+}
+
+static esp_err_t _read_block(const dht11_store_t* store, uint32_t sector, uint32_t slot, dht11_store_block_t* block) {
+    return store->flash.read(store->flash.ctx, _block_offset(sector, slot), block, sizeof(*block));
+}
+
+static bool _block_valid(const dht11_store_block_t* block) {
+    return block->count > 0 && block->len <= DHT11_STORE_BLOCK_PAYLOAD &&
+           block->crc == _dht11_store_crc16(block, offsetof(dht11_store_block_t, crc));
+}
+
+// Fetches the block a cursor points at, the open block comes straight from RAM
+static bool _load_block(const dht11_store_t* store, uint32_t seq, uint32_t slot, dht11_store_block_t* block) {
+    if (seq == store->head_seq && slot == store->head_slot) {
+        block->count = (uint8_t)store->open.count;
+        block->len   = (uint8_t)store->open.len;
+        memcpy(block->payload, store->open_payload, store->open.len);
+        return block->count > 0;
+    }
+
+    if (_read_block(store, _sector_for_seq(store, seq), slot, block) != ESP_OK || !_block_valid(block)) {
+        return false;
+    }
+    return true;
+}
+
+static esp_err_t _start_sector(dht11_store_t* store, uint32_t sector, uint32_t seq) {
+    esp_err_t ret = store->flash.erase_sector(store->flash.ctx, _sector_offset(sector));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    dht11_store_header_t header = {
+        .magic      = DHT11_STORE_MAGIC,
+        .seq        = seq,
+        .version    = DHT11_STORE_VERSION,
+        .block_size = sizeof(dht11_store_block_t),
+        .reserved   = 0xFFFF,
+    };
+    header.crc = _dht11_store_crc16(&header, offsetof(dht11_store_header_t, crc));
+
+    ret = store->flash.write(store->flash.ctx, _sector_offset(sector), &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    store->head_sector = sector;
+    store->head_seq    = seq;
+    store->head_slot   = 0;
+    if (store->head_seq - store->tail_seq >= store->num_sectors) {
+        store->tail_seq = store->head_seq - store->num_sectors + 1;
+    }
+    return ESP_OK;
+}
+
+// Keeps the open block addressable by always having a free slot in the head sector
+static esp_err_t _ensure_free_slot(dht11_store_t* store) {
+    if (store->head_slot < DHT11_STORE_BLOCKS_PER_SECTOR) {
+        return ESP_OK;
+    }
+    uint32_t next = (store->head_sector + 1) % store->num_sectors;
+    return _start_sector(store, next, store->head_seq + 1);
+}
+
+esp_err_t dht11_store_mount(dht11_store_t* store, const dht11_store_flash_t* flash) {
+    memset(store, 0, sizeof(*store));
+    store->flash       = *flash;
+    store->num_sectors = flash->size / DHT11_STORE_SECTOR_SIZE;
+    dht11_codec_encoder_init(&store->open, store->open_payload, sizeof(store->open_payload));
+
+    if (store->num_sectors < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // 1. Newest valid sector is the head
+    bool found = false;
+    for (uint32_t sector = 0; sector < store->num_sectors; sector++) {
+        dht11_store_header_t header;
+        if (_read_header(store, sector, &header) && (!found || header.seq > store->head_seq)) {
+            found              = true;
+            store->head_sector = sector;
+            store->head_seq    = header.seq;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(TAG, "No valid log found, formatting %lu sectors", (unsigned long)store->num_sectors);
+        store->tail_seq = 1;
+        return _start_sector(store, 0, 1);
+    }
+
+    // 2. Walk back while the sectors before it hold the preceding sequence numbers
+    store->tail_seq = store->head_seq;
+    for (uint32_t back = 1; back < store->num_sectors && store->tail_seq > 1; back++) {
+        uint32_t sector = (store->head_sector + store->num_sectors - back) % store->num_sectors;
+        dht11_store_header_t header;
+        if (!_read_header(store, sector, &header) || header.seq != store->tail_seq - 1) {
+            break;
+        }
+        store->tail_seq = header.seq;
+    }
+
+    // 3. Append after the last slot that was ever programmed, torn blocks included
+    store->head_slot = 0;
+    for (uint32_t slot = DHT11_STORE_BLOCKS_PER_SECTOR; slot > 0; slot--) {
+        dht11_store_block_t block;
+        esp_err_t ret = _read_block(store, store->head_sector, slot - 1, &block);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (!_is_erased(&block, sizeof(block))) {
+            store->head_slot = slot;
+            break;
+        }
+    }
+
+    ESP_LOGI(TAG, "Mounted log, sectors %lu..%lu, head slot %lu",
+             (unsigned long)store->tail_seq, (unsigned long)store->head_seq, (unsigned long)store->head_slot);
+    return _ensure_free_slot(store);
+}
+
+static esp_err_t _seal_open_block(dht11_store_t* store) {
+    dht11_store_block_t block;
+    memset(&block, 0xFF, sizeof(block));
+    block.count = (uint8_t)store->open.count;
+    block.len   = (uint8_t)store->open.len;
+    memcpy(block.payload, store->open_payload, store->open.len);
+    block.crc = _dht11_store_crc16(&block, offsetof(dht11_store_block_t, crc));
+
+    // The slot is consumed even if the write fails, it is never programmed twice
+    size_t offset = _block_offset(store->head_sector, store->head_slot);
+    store->head_slot++;
+    dht11_codec_encoder_init(&store->open, store->open_payload, sizeof(store->open_payload));
+
+    esp_err_t ret = store->flash.write(store->flash.ctx, offset, &block, sizeof(block));
+    esp_err_t next_ret = _ensure_free_slot(store);
+    return ret != ESP_OK ? ret : next_ret;
+}
+
+esp_err_t dht11_store_append(dht11_store_t* store, const dht11_reading_t* reading) {
+    if (dht11_codec_encode(&store->open, reading)) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = _seal_open_block(store);
+    dht11_codec_encode(&store->open, reading);
+    return ret;
+}
+
+void dht11_store_begin(const dht11_store_t* store, dht11_store_cursor_t* cursor) {
+    cursor->seq    = store->tail_seq;
+    cursor->slot   = 0;
+    cursor->sample = 0;
+}
+
+void dht11_store_seek_last(const dht11_store_t* store, uint32_t count, dht11_store_cursor_t* cursor) {
+    cursor->seq    = store->head_seq;
+    cursor->slot   = store->head_slot;
+    cursor->sample = 0;
+
+    while (true) {
+        dht11_store_block_t block;
+        uint32_t block_count = _load_block(store, cursor->seq, cursor->slot, &block) ? block.count : 0;
+        if (block_count >= count) {
+            cursor->sample = block_count - count;
+            return;
+        }
+        count -= block_count;
+
+        if (cursor->slot == 0) {
+            if (cursor->seq == store->tail_seq) {
+                return;
+            }
+            cursor->seq--;
+            cursor->slot = DHT11_STORE_BLOCKS_PER_SECTOR;
+        }
+        cursor->slot--;
+    }
+}
+
+static bool _first_timestamp(const dht11_store_t* store, uint32_t seq, time_t* timestamp) {
+    uint32_t limit = (seq == store->head_seq) ? store->head_slot + 1 : DHT11_STORE_BLOCKS_PER_SECTOR;
+
+    for (uint32_t slot = 0; slot < limit; slot++) {
+        dht11_store_block_t block;
+        dht11_codec_decoder_t dec;
+        dht11_reading_t reading;
+        if (_load_block(store, seq, slot, &block)) {
+            dht11_codec_decoder_init(&dec, block.payload, block.len, block.count);
+            if (dht11_codec_decode(&dec, &reading)) {
+                *timestamp = reading.timestamp;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Binary search for the last sector starting at or before `from`, then scan forward from it.
+// Assumes timestamps only move forward, which holds once SNTP has set the clock.
+esp_err_t dht11_store_seek_time(const dht11_store_t* store, time_t from, dht11_store_cursor_t* cursor) {
+    uint32_t lo = store->tail_seq;
+    uint32_t hi = store->head_seq;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        time_t first;
+        if (_first_timestamp(store, mid, &first) && first <= from) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    cursor->seq    = lo;
+    cursor->slot   = 0;
+    cursor->sample = 0;
+
+    while (cursor->seq < store->head_seq || cursor->slot <= store->head_slot) {
+        if (cursor->slot >= DHT11_STORE_BLOCKS_PER_SECTOR) {
+            cursor->seq++;
+            cursor->slot = 0;
+            continue;
+        }
+
+        dht11_store_block_t block;
+        if (_load_block(store, cursor->seq, cursor->slot, &block)) {
+            dht11_codec_decoder_t dec;
+            dht11_reading_t reading;
+            dht11_codec_decoder_init(&dec, block.payload, block.len, block.count);
+            for (cursor->sample = 0; dht11_codec_decode(&dec, &reading); cursor->sample++) {
+                if (reading.timestamp >= from) {
+                    return ESP_OK;
+                }
+            }
+        }
+
+        if (cursor->seq == store->head_seq && cursor->slot == store->head_slot) {
+            return ESP_OK;
+        }
+        cursor->slot++;
+        cursor->sample = 0;
+    }
+    return ESP_OK;
+}
+
+size_t dht11_store_read(const dht11_store_t* store, dht11_store_cursor_t* cursor, dht11_reading_t* out, size_t max) {
+    size_t count = 0;
+
+    while (count < max) {
+        // The writer may have recycled the sector under a slow reader, skip ahead
+        if (cursor->seq < store->tail_seq) {
+            cursor->seq    = store->tail_seq;
+            cursor->slot   = 0;
+            cursor->sample = 0;
+        }
+        if (cursor->seq > store->head_seq || (cursor->seq == store->head_seq && cursor->slot > store->head_slot)) {
+            break;
+        }
+        if (cursor->slot >= DHT11_STORE_BLOCKS_PER_SECTOR) {
+            cursor->seq++;
+            cursor->slot   = 0;
+            cursor->sample = 0;
+            continue;
+        }
+
+        bool is_open = (cursor->seq == store->head_seq && cursor->slot == store->head_slot);
+        dht11_store_block_t block;
+        if (!_load_block(store, cursor->seq, cursor->slot, &block)) {
+            if (is_open) {
+                break;
+            }
+            ESP_LOGW(TAG, "Skipping corrupt block %lu in sector %lu", (unsigned long)cursor->slot, (unsigned long)cursor->seq);
+            cursor->slot++;
+            cursor->sample = 0;
+            continue;
+        }
+
+        dht11_codec_decoder_t dec;
+        dht11_reading_t reading;
+        dht11_codec_decoder_init(&dec, block.payload, block.len, block.count);
+        for (uint32_t skipped = 0; skipped < cursor->sample; skipped++) {
+            dht11_codec_decode(&dec, &reading);
+        }
+        while (count < max && dht11_codec_decode(&dec, &out[count])) {
+            count++;
+            cursor->sample++;
+        }
+
+        if (cursor->sample < block.count) {
+            break;
+        }
+        if (is_open) {
+            break;
+        }
+        cursor->slot++;
+        cursor->sample = 0;
+    }
+
+    return count;
+}
+
+#ifdef ESP_PLATFORM
+
+static esp_err_t _partition_read(void* ctx, size_t offset, void* dst, size_t len) {
+    return esp_partition_read((const esp_partition_t*)ctx, offset, dst, len);
+}
+
+static esp_err_t _partition_write(void* ctx, size_t offset, const void* src, size_t len) {
+    return esp_partition_write((const esp_partition_t*)ctx, offset, src, len);
+}
+
+static esp_err_t _partition_erase_sector(void* ctx, size_t offset) {
+    return esp_partition_erase_range((const esp_partition_t*)ctx, offset, DHT11_STORE_SECTOR_SIZE);
+}
+
+esp_err_t dht11_store_partition_flash(dht11_store_flash_t* flash) {
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                                DHT11_STORE_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "Partition '%s' not found", DHT11_STORE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    flash->read         = _partition_read;
+    flash->write        = _partition_write;
+    flash->erase_sector = _partition_erase_sector;
+    flash->ctx          = (void*)partition;
+    flash->size         = partition->size;
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,88 @@
+// dht11_store.h
+
+#pragma once
+
+#include "dht11_codec.h"
+#include "dht11_reading.h"
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define DHT11_STORE_PARTITION_LABEL "dhtlog"
+#define DHT11_STORE_SECTOR_SIZE     4096
+#define DHT11_STORE_MAGIC           0x4C544844
+#define DHT11_STORE_VERSION         2
+#define DHT11_STORE_BLOCK_SIZE      64
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t version;
+    uint16_t block_size;
+    uint16_t reserved;
+    uint16_t crc;
+} dht11_store_header_t;
+
+#define DHT11_STORE_BLOCK_PAYLOAD (DHT11_STORE_BLOCK_SIZE - 4)
+
+// Fixed-size block of codec-encoded readings
+typedef struct __attribute__((packed)) {
+    uint8_t count;
+    uint8_t len;
+    uint8_t payload[DHT11_STORE_BLOCK_PAYLOAD];
+    uint16_t crc;
+} dht11_store_block_t;
+
+#define DHT11_STORE_BLOCKS_PER_SECTOR \
+    ((DHT11_STORE_SECTOR_SIZE - sizeof(dht11_store_header_t)) / sizeof(dht11_store_block_t))
+
+// Raw flash access, backed by a partition on target and by a file in host tests
+typedef struct {
+    esp_err_t (*read)(void* ctx, size_t offset, void* dst, size_t len);
+    esp_err_t (*write)(void* ctx, size_t offset, const void* src, size_t len);
+    esp_err_t (*erase_sector)(void* ctx, size_t offset);
+    void* ctx;
+    size_t size;
+} dht11_store_flash_t;
+
+// Append-only log of fixed-size blocks over a ring of sectors. Every sector starts with
+// a header carrying a monotonically increasing sequence number, the oldest sector is the
+// one erased next so wear is spread evenly, and each block has its own CRC so a write
+// torn by a reset is skipped on the next scan. Readings collect in an open block in RAM
+// and are written once it is full, so a reset loses at most that block.
+// Not thread-safe, callers serialize access.
+typedef struct {
+    dht11_store_flash_t flash;
+    uint32_t num_sectors;
+    uint32_t head_sector;
+    uint32_t head_seq;
+    uint32_t head_slot;
+    uint32_t tail_seq;
+    dht11_codec_encoder_t open;
+    uint8_t open_payload[DHT11_STORE_BLOCK_PAYLOAD];
+} dht11_store_t;
+
+// slot == head_slot in the head sector addresses the open block
+typedef struct {
+    uint32_t seq;
+    uint32_t slot;
+    uint32_t sample;
+} dht11_store_cursor_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t dht11_store_partition_flash(dht11_store_flash_t* flash);
+esp_err_t dht11_store_mount(dht11_store_t* store, const dht11_store_flash_t* flash);
+esp_err_t dht11_store_append(dht11_store_t* store, const dht11_reading_t* reading);
+
+void dht11_store_begin(const dht11_store_t* store, dht11_store_cursor_t* cursor);
+void dht11_store_seek_last(const dht11_store_t* store, uint32_t count, dht11_store_cursor_t* cursor);
+esp_err_t dht11_store_seek_time(const dht11_store_t* store, time_t from, dht11_store_cursor_t* cursor);
+size_t dht11_store_read(const dht11_store_t* store, dht11_store_cursor_t* cursor, dht11_reading_t* out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
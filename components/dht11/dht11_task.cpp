@@ -14,9 +14,31 @@
 static const char* TAG = "DHT11_TASK";
 static DHT11Sensor* s_dht11_instance = nullptr;
 
-DHT11Sensor::DHT11Sensor(TaskHandle_t lcd_handle) : lcd_task_handle(lcd_handle) {
+typedef struct {
+    dht11_listener_t listener;
+    void* ctx;
+} dht11_listener_entry_t;
+
+// Listeners are only ever added, and may register before the sensor task exists
+static dht11_listener_entry_t s_listeners[DHT11_MAX_LISTENERS];
+static size_t s_num_listeners = 0;
+static portMUX_TYPE s_listeners_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void _dht11_notify_listeners(const dht11_snapshot_t* snapshot) {
+    portENTER_CRITICAL(&s_listeners_lock);
+    size_t count = s_num_listeners;
+    portEXIT_CRITICAL(&s_listeners_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        s_listeners[i].listener(snapshot, s_listeners[i].ctx);
+    }
+}
+
+DHT11Sensor::DHT11Sensor() {
+    dht11_codec_encoder_init(&this -> history_encoder, this -> history_chunks[0].data, DHT_HISTORY_CHUNK_SIZE);
     this -> mutex = xSemaphoreCreateMutex();
-    if (!this -> mutex) {
+    this -> store_mutex = xSemaphoreCreateMutex();
+    if (!this -> mutex || !this -> store_mutex) {
         ESP_LOGE(TAG, "Failed to create mutex!");
     }
 }
@@ -25,15 +47,26 @@ DHT11Sensor::~DHT11Sensor() {
     if (this -> mutex) {
         vSemaphoreDelete(this -> mutex);
     }
+    if (this -> store_mutex) {
+        vSemaphoreDelete(this -> store_mutex);
+    }
     if (this -> taskHandle) {
         vTaskDelete(this -> taskHandle);
     }
 }
 
 esp_err_t DHT11Sensor::start_task() {
-    if (!this -> mutex) {
+    if (!this -> mutex || !this -> store_mutex) {
         return ESP_FAIL;
     }
+
+    dht11_store_flash_t flash;
+    if (dht11_store_partition_flash(&flash) == ESP_OK && dht11_store_mount(&this -> store, &flash) == ESP_OK) {
+        this -> store_mounted = true;
+    } else {
+        ESP_LOGW(TAG, "History log unavailable, keeping the last %d readings in RAM only", DHT_HISTORY_SIZE);
+    }
+
     BaseType_t result = xTaskCreate(read_data_task_wrapper, "dht11_task", 4096, this, DHT11_TASK_PRIORITY, &this -> taskHandle);
     if (result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create DHT11 task!");
@@ -62,11 +95,19 @@ void DHT11Sensor::read_data_loop() {
     ESP_LOGI(TAG, "Dummy reading taken");
     vTaskDelay(pdMS_TO_TICKS(DHT11_COOLDOWN));
 
+    uint64_t next_periodic_read = esp_timer_get_time();
+
     while (true) {
         esp_err_t ret;
         uint64_t current_time_us = esp_timer_get_time();
         uint64_t time_since_last_read = current_time_us - last_read_attempt_time;
 
+        if (current_time_us < next_periodic_read && !this->read_pending()) {
+            uint64_t remaining_wait = next_periodic_read - current_time_us;
+            xTaskNotifyWait(0, 0, nullptr, pdMS_TO_TICKS(remaining_wait / 1000) + 1);
+            continue;
+        }
+
         if (time_since_last_read < MIN_READ_INTERVAL_US) {
             uint64_t remaining_wait = MIN_READ_INTERVAL_US - time_since_last_read;
             xTaskNotifyWait(0, 0, nullptr, pdMS_TO_TICKS(remaining_wait / 1000));
@@ -88,37 +129,25 @@ void DHT11Sensor::read_data_loop() {
 
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "CRITICAL ERROR, FAILED TO READ DHT11 DATA");
+            speaker_play_clip(SPEAKER_CLIP_ERROR);
         } else {
-            if (xSemaphoreTake(this -> mutex, portMAX_DELAY) == pdTRUE) {
-                this->temperature = temp_c * (9.0 / 5.0) + 32;
-                this->humidity = hum_c;
-
-                this->dht_history[this->history_idx].temperature = this->temperature;
-                this->dht_history[this->history_idx].humidity = this->humidity;
-                this->dht_history[this->history_idx].timestamp = time(NULL);
-                this->history_idx++;
-                if (this->history_idx == DHT_HISTORY_SIZE) {
-                    this->history_idx = 0;
-                }
-                if (this->num_history_readings < DHT_HISTORY_SIZE) {
-                    this->num_history_readings++;
-                }
-                this->last_successful_read = esp_timer_get_time();
+            float temperature_f = temp_c * (9.0 / 5.0) + 32;
+            this->publish_snapshot(temperature_f, hum_c);
 
-                xSemaphoreGive(this->mutex);
+            dht11_reading_t reading = {temperature_f, hum_c, time(NULL)};
+            this->record_history(&reading);
 
-                speaker_play_sound();
-                if (this -> lcd_task_handle) {
-                    xTaskNotifyGive(this -> lcd_task_handle);
-                    ESP_LOGI(TAG, "Notified LCD of new data");
-                }
-            } else {
-                ESP_LOGE(TAG, "ERROR: dht11 read task failed to take mutex");
-            }
+            dht11_snapshot_t snapshot;
+            this->get_snapshot(&snapshot);
+            _dht11_notify_listeners(&snapshot);
+
+            speaker_play_sound();
 
-            ESP_LOGI(TAG, "Temperature: %.2f F, Humidity: %.1f %%", this->temperature, this->humidity);
+            ESP_LOGI(TAG, "Temperature: %.2f F, Humidity: %.1f %%", temperature_f, hum_c);
         }
-        xTaskNotifyWait(0, 0, nullptr, pdMS_TO_TICKS(60000));
+
+        this->complete_reads(ret);
+        next_periodic_read = esp_timer_get_time() + (uint64_t)DHT11_SAMPLE_PERIOD_MS * 1000;
     }
 }
 
@@ -136,12 +165,86 @@ float dht11_get_humidity() {
     return NAN;
 }
 
+void dht11_get_snapshot(dht11_snapshot_t* snapshot) {
+    if (s_dht11_instance) {
+        s_dht11_instance->get_snapshot(snapshot);
+        return;
+    }
+    *snapshot = {NAN, NAN, 0, 0, 0};
+}
+
+void dht11_history_seek(time_t from, dht11_history_cursor_t* cursor) {
+    if (s_dht11_instance) {
+        s_dht11_instance->history_seek(from, cursor);
+        return;
+    }
+    cursor->seq = 0;
+    cursor->slot = 0;
+    cursor->sample = 0;
+}
+
+void dht11_history_seek_last(uint32_t count, dht11_history_cursor_t* cursor) {
+    if (s_dht11_instance) {
+        s_dht11_instance->history_seek_last(count, cursor);
+        return;
+    }
+    cursor->seq = 0;
+    cursor->slot = 0;
+    cursor->sample = 0;
+}
+
+uint32_t dht11_history_read(dht11_history_cursor_t* cursor, dht11_reading_t* buffer, uint32_t max) {
+    if (s_dht11_instance) {
+        return s_dht11_instance->history_read(cursor, buffer, max);
+    }
+    return 0;
+}
+
 void dht11_notify_read() {
     if (s_dht11_instance) {
         s_dht11_instance -> notify_read();
     }
 }
 
+esp_err_t dht11_add_listener(dht11_listener_t listener, void* ctx) {
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&s_listeners_lock);
+    if (s_num_listeners < DHT11_MAX_LISTENERS) {
+        s_listeners[s_num_listeners].listener = listener;
+        s_listeners[s_num_listeners].ctx      = ctx;
+        s_num_listeners++;
+    } else {
+        ret = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&s_listeners_lock);
+
+    return ret;
+}
+
+esp_err_t dht11_request_read(dht11_read_ticket_t* ticket) {
+    if (s_dht11_instance) {
+        return s_dht11_instance->request_read(ticket, nullptr, nullptr);
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
+// Never blocks, the result arrives through on_done. When an error is returned on_done is
+// not called and the ticket is free again.
+esp_err_t dht11_request_read_async(dht11_read_ticket_t* ticket, dht11_read_done_t on_done, void* ctx) {
+    if (s_dht11_instance && on_done) {
+        return s_dht11_instance->request_read(ticket, on_done, ctx);
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t dht11_wait_read(dht11_read_ticket_t* ticket, TickType_t timeout, dht11_snapshot_t* snapshot) {
+    if (s_dht11_instance) {
+        return s_dht11_instance->wait_read(ticket, timeout, snapshot);
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
 void dht11_get_history(dht11_reading_t* history_buffer, uint32_t* num_readings) {
     if (s_dht11_instance) {
         s_dht11_instance->get_history(history_buffer, num_readings);
@@ -156,17 +259,128 @@ uint64_t dht11_get_last_read() {
 }
 
 void DHT11Sensor::notify_read() {
-    if (this->taskHandle) {
+    if (!this->taskHandle) {
+        ESP_LOGE(TAG, "DHT11 TASK HANDLE IS NULL, CAN'T SEND NOTIF");
+        return;
+    }
+
+    dht11_snapshot_t snap;
+    if (this->is_fresh(&snap) || xSemaphoreTake(this->mutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    bool idle = !this->pending_tickets && !this->read_requested;
+    this->read_requested = true;
+    xSemaphoreGive(this->mutex);
+
+    if (idle) {
         xTaskNotifyGive(this->taskHandle);
         ESP_LOGI(TAG, "Sent notification to DHT11 task to read NOW");
+    }
+}
+
+bool DHT11Sensor::is_fresh(dht11_snapshot_t* snap) {
+    this->get_snapshot(snap);
+    return snap->monotonic_us != 0 && esp_timer_get_time() - snap->monotonic_us < MIN_READ_INTERVAL_US;
+}
+
+bool DHT11Sensor::read_pending() {
+    bool pending = false;
+    if (xSemaphoreTake(this->mutex, portMAX_DELAY) == pdTRUE) {
+        pending = this->pending_tickets || this->read_requested;
+        xSemaphoreGive(this->mutex);
+    }
+    return pending;
+}
+
+// Hands a finished ticket back, the owner may free it as soon as this returns
+static void _dht11_ticket_done(dht11_read_ticket_t* ticket) {
+    if (ticket->on_done) {
+        ticket->on_done(ticket);
     } else {
-        ESP_LOGE(TAG, "DHT11 TASK HANDLE IS NULL, CAN'T SEND NOTIF");
+        xSemaphoreGive(ticket->done);
+    }
+}
+
+esp_err_t DHT11Sensor::request_read(dht11_read_ticket_t* ticket, dht11_read_done_t on_done, void* ctx) {
+    ticket->done = on_done ? nullptr : xSemaphoreCreateBinaryStatic(&ticket->done_buffer);
+    ticket->on_done = on_done;
+    ticket->ctx = ctx;
+    ticket->result = ESP_ERR_TIMEOUT;
+    ticket->next = nullptr;
+
+    if (!this->taskHandle || xSemaphoreTake(this->mutex, portMAX_DELAY) != pdTRUE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A reading younger than the minimum interval is as new as the sensor can give
+    if (this->is_fresh(&ticket->snapshot)) {
+        ticket->result = ESP_OK;
+        _dht11_ticket_done(ticket);
+        xSemaphoreGive(this->mutex);
+        return ESP_OK;
+    }
+
+    bool idle = !this->pending_tickets && !this->read_requested;
+    ticket->next = this->pending_tickets;
+    this->pending_tickets = ticket;
+    xSemaphoreGive(this->mutex);
+
+    if (idle) {
+        xTaskNotifyGive(this->taskHandle);
+    }
+    return ESP_OK;
+}
+
+// Tickets are completed under the mutex, so once wait_read holds it the sensor task is
+// done touching the caller's ticket either way
+esp_err_t DHT11Sensor::wait_read(dht11_read_ticket_t* ticket, TickType_t timeout, dht11_snapshot_t* out) {
+    if (xSemaphoreTake(ticket->done, timeout) != pdTRUE) {
+        xSemaphoreTake(this->mutex, portMAX_DELAY);
+        for (dht11_read_ticket_t** link = &this->pending_tickets; *link; link = &(*link)->next) {
+            if (*link == ticket) {
+                *link = ticket->next;
+                break;
+            }
+        }
+        xSemaphoreGive(this->mutex);
+    }
+
+    vSemaphoreDelete(ticket->done);
+    if (out && ticket->result == ESP_OK) {
+        *out = ticket->snapshot;
     }
+    return ticket->result;
 }
 
-esp_err_t start_dht11_sensor_task(TaskHandle_t lcd_task_handle) {
+void DHT11Sensor::complete_reads(esp_err_t result) {
+    dht11_snapshot_t snap;
+    this->get_snapshot(&snap);
+
+    if (xSemaphoreTake(this->mutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+
+    int completed = 0;
+    for (dht11_read_ticket_t* ticket = this->pending_tickets; ticket; ) {
+        dht11_read_ticket_t* next = ticket->next;
+        ticket->result = result;
+        ticket->snapshot = snap;
+        _dht11_ticket_done(ticket);
+        ticket = next;
+        completed++;
+    }
+    this->pending_tickets = nullptr;
+    this->read_requested = false;
+    xSemaphoreGive(this->mutex);
+
+    if (completed > 0) {
+        ESP_LOGI(TAG, "One read served %d request(s)", completed);
+    }
+}
+
+esp_err_t start_dht11_sensor_task() {
     if (s_dht11_instance == nullptr) {
-        s_dht11_instance = new DHT11Sensor(lcd_task_handle);
+        s_dht11_instance = new DHT11Sensor();
     }
     if (s_dht11_instance == nullptr) {
         ESP_LOGE(TAG, "Failed to create DHT11Sensor instance!");
@@ -176,51 +390,204 @@ esp_err_t start_dht11_sensor_task(TaskHandle_t lcd_task_handle) {
 }
 
 
+// Seqlock: the sensor task is the only writer and bumps the sequence to odd while it
+// updates the snapshot, readers retry until they copy it between two equal even values.
+void DHT11Sensor::publish_snapshot(float temperature, float humidity) {
+    uint32_t seq = this->snapshot_seq.load(std::memory_order_relaxed);
+    this->snapshot_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    this->snapshot.temperature = temperature;
+    this->snapshot.humidity = humidity;
+    this->snapshot.timestamp = time(NULL);
+    this->snapshot.monotonic_us = esp_timer_get_time();
+    this->snapshot.sequence = (seq + 2) / 2;
+
+    this->snapshot_seq.store(seq + 2, std::memory_order_release);
+}
+
+void DHT11Sensor::get_snapshot(dht11_snapshot_t* out) {
+    uint32_t seq_start;
+    uint32_t seq_end;
+    do {
+        seq_start = this->snapshot_seq.load(std::memory_order_acquire);
+        *out = this->snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seq_end = this->snapshot_seq.load(std::memory_order_relaxed);
+    } while ((seq_start & 1) || seq_start != seq_end);
+}
+
 float DHT11Sensor::get_temperature() {
-    float temp_read = NAN;
-    if (xSemaphoreTake(this->mutex, portMAX_DELAY) == pdTRUE) {
-        temp_read = this->temperature;
-        xSemaphoreGive(this->mutex);
-    } else {
-        ESP_LOGE(TAG, "ERROR: dht11_get_temperature failed to take mutex!");
-    }
-    return temp_read;
+    dht11_snapshot_t snap;
+    this->get_snapshot(&snap);
+    return snap.temperature;
 }
 
 float DHT11Sensor::get_humidity() {
-    float hum_read = NAN;
+    dht11_snapshot_t snap;
+    this->get_snapshot(&snap);
+    return snap.humidity;
+}
+
+void DHT11Sensor::record_history(const dht11_reading_t* reading) {
     if (xSemaphoreTake(this->mutex, portMAX_DELAY) == pdTRUE) {
-        hum_read = this->humidity;
+        dht11_history_chunk_t* chunk = &this->history_chunks[this->history_chunk_idx];
+
+        if (!dht11_codec_encode(&this->history_encoder, reading)) {
+            // Current chunk is full, recycle the oldest one
+            this->history_chunk_idx = (this->history_chunk_idx + 1) % DHT_HISTORY_CHUNKS;
+            chunk = &this->history_chunks[this->history_chunk_idx];
+            chunk->first_index = this->total_history_readings;
+            dht11_codec_encoder_init(&this->history_encoder, chunk->data, DHT_HISTORY_CHUNK_SIZE);
+            dht11_codec_encode(&this->history_encoder, reading);
+        }
+        chunk->len = this->history_encoder.len;
+        chunk->count = this->history_encoder.count;
+        this->total_history_readings++;
+
         xSemaphoreGive(this->mutex);
     } else {
-        ESP_LOGE(TAG, "ERROR: dht11_get_humidity failed to take mutex!");
+        ESP_LOGE(TAG, "ERROR: dht11 read task failed to take mutex");
+    }
+
+    // Sealing a block erases a sector now and then, which takes tens of milliseconds
+    if (this->store_mounted && xSemaphoreTake(this->store_mutex, portMAX_DELAY) == pdTRUE) {
+        esp_err_t ret = dht11_store_append(&this->store, reading);
+        xSemaphoreGive(this->store_mutex);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to append reading to history log: %s", esp_err_to_name(ret));
+        }
     }
-    return hum_read;
 }
 
-void DHT11Sensor::get_history(dht11_reading_t* history_buffer, uint32_t* num_readings) {
-    if (xSemaphoreTake(this->mutex, portMAX_DELAY) == pdTRUE) {
-        *num_readings = this->num_history_readings;
-        if (this->num_history_readings > 0) {
-            int start_idx = (this->history_idx - this->num_history_readings + DHT_HISTORY_SIZE) % DHT_HISTORY_SIZE;
-            for (int i = 0; i < this->num_history_readings; i++) {
-                int current_buffer_idx = (start_idx + i) % DHT_HISTORY_SIZE;
-                history_buffer[i] = this->dht_history[current_buffer_idx];
+// History lives either in the flash log or in the RAM chunks, fixed once the task starts
+SemaphoreHandle_t DHT11Sensor::history_lock() {
+    return this->store_mounted ? this->store_mutex : this->mutex;
+}
+
+uint32_t DHT11Sensor::ram_history_oldest() {
+    uint32_t oldest = this->total_history_readings;
+    for (int i = 0; i < DHT_HISTORY_CHUNKS; i++) {
+        if (this->history_chunks[i].count > 0 && this->history_chunks[i].first_index < oldest) {
+            oldest = this->history_chunks[i].first_index;
+        }
+    }
+    return oldest;
+}
+
+uint32_t DHT11Sensor::ram_history_read(dht11_history_cursor_t* cursor, dht11_reading_t* buffer, uint32_t max) {
+    uint32_t count = 0;
+    uint32_t oldest = this->ram_history_oldest();
+    if (cursor->slot < oldest) {
+        cursor->slot = oldest;
+    }
+
+    while (count < max && cursor->slot < this->total_history_readings) {
+        const dht11_history_chunk_t* chunk = nullptr;
+        for (int i = 0; i < DHT_HISTORY_CHUNKS; i++) {
+            const dht11_history_chunk_t* candidate = &this->history_chunks[i];
+            if (candidate->count > 0 && cursor->slot >= candidate->first_index &&
+                cursor->slot < candidate->first_index + candidate->count) {
+                chunk = candidate;
+                break;
             }
         }
-        xSemaphoreGive(this->mutex);
+        if (chunk == nullptr) {
+            break;
+        }
+
+        dht11_codec_decoder_t dec;
+        dht11_reading_t skipped;
+        dht11_codec_decoder_init(&dec, chunk->data, chunk->len, chunk->count);
+        for (uint32_t i = chunk->first_index; i < cursor->slot; i++) {
+            dht11_codec_decode(&dec, &skipped);
+        }
+        while (count < max && dht11_codec_decode(&dec, &buffer[count])) {
+            count++;
+            cursor->slot++;
+        }
+    }
+
+    return count;
+}
+
+void DHT11Sensor::get_history(dht11_reading_t* history_buffer, uint32_t* num_readings) {
+    dht11_history_cursor_t cursor;
+    this->history_seek_last(DHT_HISTORY_SIZE, &cursor);
+    *num_readings = this->history_read(&cursor, history_buffer, DHT_HISTORY_SIZE);
+}
+
+void DHT11Sensor::history_seek_last(uint32_t count, dht11_history_cursor_t* cursor) {
+    cursor->seq = 0;
+    cursor->slot = 0;
+    cursor->sample = 0;
+
+    if (xSemaphoreTake(this->history_lock(), portMAX_DELAY) != pdTRUE) {
+        ESP_LOGE(TAG, "ERROR: dht11_history_seek_last failed to take mutex!");
+        return;
+    }
+
+    if (this->store_mounted) {
+        dht11_store_seek_last(&this->store, count, cursor);
+    } else if (this->total_history_readings > count) {
+        cursor->slot = this->total_history_readings - count;
+    }
+    xSemaphoreGive(this->history_lock());
+}
+
+void DHT11Sensor::history_seek(time_t from, dht11_history_cursor_t* cursor) {
+    cursor->seq = 0;
+    cursor->slot = 0;
+    cursor->sample = 0;
+
+    if (xSemaphoreTake(this->history_lock(), portMAX_DELAY) != pdTRUE) {
+        ESP_LOGE(TAG, "ERROR: dht11_history_seek failed to take mutex!");
+        return;
+    }
+
+    if (this->store_mounted) {
+        dht11_store_seek_time(&this->store, from, cursor);
     } else {
-        ESP_LOGE(TAG, "ERROR: dht11_get_history failed to take mutex!");
-        *num_readings = 0;
+        // Chunks after the current one are the oldest, walk them in order
+        cursor->slot = this->total_history_readings;
+        for (int i = 1; i <= DHT_HISTORY_CHUNKS; i++) {
+            const dht11_history_chunk_t* chunk = &this->history_chunks[(this->history_chunk_idx + i) % DHT_HISTORY_CHUNKS];
+            dht11_codec_decoder_t dec;
+            dht11_reading_t reading;
+            dht11_codec_decoder_init(&dec, chunk->data, chunk->len, chunk->count);
+            for (uint32_t index = chunk->first_index; dht11_codec_decode(&dec, &reading); index++) {
+                if (reading.timestamp >= from) {
+                    cursor->slot = index;
+                    xSemaphoreGive(this->history_lock());
+                    return;
+                }
+            }
+        }
     }
+    xSemaphoreGive(this->history_lock());
 }
 
-uint64_t DHT11Sensor::get_last_read() {
-    uint64_t time_read = 0;
-    if (xSemaphoreTake(this->mutex, portMAX_DELAY) == pdTRUE) {
-        time_read = this->last_successful_read;
-        xSemaphoreGive(this->mutex);
+// Copies at most `max` readings per call so the mutex is only held briefly
+uint32_t DHT11Sensor::history_read(dht11_history_cursor_t* cursor, dht11_reading_t* buffer, uint32_t max) {
+    uint32_t count = 0;
+
+    if (xSemaphoreTake(this->history_lock(), portMAX_DELAY) != pdTRUE) {
+        ESP_LOGE(TAG, "ERROR: dht11_history_read failed to take mutex!");
+        return 0;
     }
-    return time_read;
+
+    if (this->store_mounted) {
+        count = dht11_store_read(&this->store, cursor, buffer, max);
+    } else {
+        count = this->ram_history_read(cursor, buffer, max);
+    }
+    xSemaphoreGive(this->history_lock());
+
+    return count;
 }
 
+uint64_t DHT11Sensor::get_last_read() {
+    dht11_snapshot_t snap;
+    this->get_snapshot(&snap);
+    return snap.monotonic_us;
+}
\ No newline at end of file
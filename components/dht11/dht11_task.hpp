@@ -2,50 +2,114 @@
 
 #pragma once
 
+#include "dht11_codec.h"
+#include "dht11_reading.h"
+#include "dht11_store.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "time.h"
+#include <stdint.h>
 
 #define DHT11_TASK_PRIORITY 15
 #define DHT11_COOLDOWN 3000 
 #define MAXATTEMPTS 3
 #define MIN_READ_INTERVAL_US 3000000
+#define DHT11_SAMPLE_PERIOD_MS 60000
 #define DHT_HISTORY_SIZE 60
+#define DHT_HISTORY_CHUNKS 8
+#define DHT_HISTORY_CHUNK_SIZE 120
+#define DHT11_MAX_LISTENERS 4
+#define DHT11_READ_TIMEOUT_MS (MAXATTEMPTS * DHT11_COOLDOWN + MIN_READ_INTERVAL_US / 1000 + 1000)
 
 typedef struct {
     float temperature;
     float humidity;
     time_t timestamp;
-} dht11_reading_t;
+    uint64_t monotonic_us;
+    uint32_t sequence;
+} dht11_snapshot_t;
+
+struct dht11_read_ticket;
+
+// Completion of a ticket started with dht11_request_read_async. Runs on the sensor task,
+// or on the caller when a fresh reading answers at once, and must not block.
+typedef void (*dht11_read_done_t)(struct dht11_read_ticket* ticket);
+
+// Caller-owned handle for one on-demand read. Every ticket pending when a read finishes is
+// completed by that read, so a burst of requests costs a single sensor transaction.
+typedef struct dht11_read_ticket {
+    StaticSemaphore_t done_buffer;
+    SemaphoreHandle_t done;
+    dht11_read_done_t on_done;
+    void* ctx;
+    esp_err_t result;
+    dht11_snapshot_t snapshot;
+    struct dht11_read_ticket* next;
+} dht11_read_ticket_t;
+
+// Called from the sensor task after every successful read, must not block
+typedef void (*dht11_listener_t)(const dht11_snapshot_t* snapshot, void* ctx);
+
+// Position in the reading history. seq is 0 when history lives in the RAM ring only,
+// slot then counts readings since boot.
+typedef dht11_store_cursor_t dht11_history_cursor_t;
 
 #ifdef __cplusplus
+#include <atomic>
 #include <cmath>
 
+// Independently decodable slice of the RAM history ring
+typedef struct {
+    uint8_t data[DHT_HISTORY_CHUNK_SIZE];
+    uint32_t first_index;
+    uint16_t len;
+    uint16_t count;
+} dht11_history_chunk_t;
+
 class DHT11Sensor {
 private:
     SemaphoreHandle_t mutex = nullptr;
-    float temperature = NAN;
-    float humidity = NAN;
+    std::atomic<uint32_t> snapshot_seq{0};
+    dht11_snapshot_t snapshot = {NAN, NAN, 0, 0, 0};
+    // The flash log has its own lock so a slow flash write never holds up the sensor state
+    SemaphoreHandle_t store_mutex = nullptr;
+    dht11_store_t store = {};
+    bool store_mounted = false;
     TaskHandle_t taskHandle = nullptr;
-    TaskHandle_t lcd_task_handle = nullptr;
-    dht11_reading_t dht_history[DHT_HISTORY_SIZE];
-    int history_idx = 0;
-    int num_history_readings = 0;
-    uint64_t last_successful_read = 0;
+    dht11_history_chunk_t history_chunks[DHT_HISTORY_CHUNKS] = {};
+    dht11_codec_encoder_t history_encoder = {};
+    int history_chunk_idx = 0;
+    uint32_t total_history_readings = 0;
+    dht11_read_ticket_t* pending_tickets = nullptr;
+    bool read_requested = false;
 
     void read_data_loop();
+    void publish_snapshot(float temperature, float humidity);
+    void record_history(const dht11_reading_t* reading);
+    SemaphoreHandle_t history_lock();
+    bool read_pending();
+    void complete_reads(esp_err_t result);
+    bool is_fresh(dht11_snapshot_t* snap);
+    uint32_t ram_history_oldest();
+    uint32_t ram_history_read(dht11_history_cursor_t* cursor, dht11_reading_t* buffer, uint32_t max);
     static void read_data_task_wrapper(void* pvParameters);
 
 public:
-    explicit DHT11Sensor(TaskHandle_t lcd_handle);
+    DHT11Sensor();
     ~DHT11Sensor();
 
     esp_err_t start_task();
     void notify_read();
+    esp_err_t request_read(dht11_read_ticket_t* ticket, dht11_read_done_t on_done, void* ctx);
+    esp_err_t wait_read(dht11_read_ticket_t* ticket, TickType_t timeout, dht11_snapshot_t* out);
     float get_temperature();
     float get_humidity();
+    void get_snapshot(dht11_snapshot_t* out);
     void get_history(dht11_reading_t* history_buffer, uint32_t* num_readings);
+    void history_seek(time_t from, dht11_history_cursor_t* cursor);
+    void history_seek_last(uint32_t count, dht11_history_cursor_t* cursor);
+    uint32_t history_read(dht11_history_cursor_t* cursor, dht11_reading_t* buffer, uint32_t max);
     uint64_t get_last_read();
 };
 #endif
@@ -57,11 +121,19 @@ extern "C" {
 esp_err_t read_dht_data(float* temperature, float* humidity, bool suppressLogErrors);
 void speaker_play_sound();
 
-esp_err_t start_dht11_sensor_task(TaskHandle_t lcd_task_handle);
+esp_err_t start_dht11_sensor_task();
 float dht11_get_temperature();
 float dht11_get_humidity();
+void dht11_get_snapshot(dht11_snapshot_t* snapshot);
 void dht11_notify_read();
+esp_err_t dht11_request_read(dht11_read_ticket_t* ticket);
+esp_err_t dht11_request_read_async(dht11_read_ticket_t* ticket, dht11_read_done_t on_done, void* ctx);
+esp_err_t dht11_wait_read(dht11_read_ticket_t* ticket, TickType_t timeout, dht11_snapshot_t* snapshot);
+esp_err_t dht11_add_listener(dht11_listener_t listener, void* ctx);
 void dht11_get_history(dht11_reading_t* history_buffer, uint32_t* num_readings);
+void dht11_history_seek(time_t from, dht11_history_cursor_t* cursor);
+void dht11_history_seek_last(uint32_t count, dht11_history_cursor_t* cursor);
+uint32_t dht11_history_read(dht11_history_cursor_t* cursor, dht11_reading_t* buffer, uint32_t max);
 uint64_t dht11_get_last_read();
 
 #ifdef __cplusplus
@@ -0,0 +1,281 @@
+// i2cbus.c
+
+#include "i2cbus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <inttypes.h>
+#include <string.h>
+
+static const char* TAG = "I2C_BUS";
+
+// Fastest first, negotiation walks down until the device keeps up
+static const uint32_t s_speeds[] = {1000000, 400000, I2C_BUS_MIN_FREQ_HZ};
+#define I2C_BUS_SPEED_COUNT (sizeof(s_speeds) / sizeof(s_speeds[0]))
+
+static i2c_master_bus_handle_t s_bus = NULL;
+static i2cbus_device_t s_devices[I2C_BUS_MAX_DEVICES];
+static size_t s_device_count = 0;
+
+static StaticSemaphore_t s_lock_buffer;
+static SemaphoreHandle_t s_lock = NULL;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Serializes everything that touches the bus: transfers, probes and the device re-adds
+// a speed change needs, across all attached devices
+static void _i2cbus_lock(void) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void _i2cbus_unlock(void) {
+    xSemaphoreGive(s_lock);
+}
+
+static esp_err_t _i2cbus_create_bus(void) {
+    if (s_bus != NULL) {
+        return ESP_OK;
+    }
+
+    i2c_master_bus_config_t bus_conf = {
+        .clk_source                   = I2C_CLK_SRC_DEFAULT,
+        .i2c_port                     = I2C_BUS_NUM,
+        .scl_io_num                   = I2C_BUS_SCL_IO,
+        .sda_io_num                   = I2C_BUS_SDA_IO,
+        .glitch_ignore_cnt            = 7,
+        .flags.enable_internal_pullup = false,
+    };
+
+    esp_err_t ret = i2c_new_master_bus(&bus_conf, &s_bus);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C bus: %s", esp_err_to_name(ret));
+        s_bus = NULL;
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "INITIALIZED I2C BUS");
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_init(void) {
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+    }
+    return _i2cbus_create_bus();
+}
+
+// The driver applies the clock per device, so changing it means re-adding the device
+static esp_err_t _i2cbus_set_speed(i2cbus_device_t* device, uint32_t scl_hz) {
+    if (device->handle != NULL) {
+        if (device->stats.scl_hz == scl_hz) {
+            return ESP_OK;
+        }
+        i2c_master_bus_rm_device(device->handle);
+        device->handle = NULL;
+    }
+
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address  = device->config.address,
+        .scl_speed_hz    = scl_hz};
+
+    esp_err_t ret = i2c_master_bus_add_device(s_bus, &dev_cfg, &device->handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add %s to I2C bus: %s", device->config.name, esp_err_to_name(ret));
+        device->handle = NULL;
+        return ret;
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    device->stats.scl_hz = scl_hz;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
+
+static bool _i2cbus_probe(i2cbus_device_t* device) {
+    for (int i = 0; i < I2C_BUS_PROBE_ATTEMPTS; i++) {
+        esp_err_t ret;
+        if (device->config.probe_len > 0) {
+            ret = i2c_master_transmit(device->handle, device->config.probe_data, device->config.probe_len, I2C_BUS_PROBE_TIMEOUT_MS);
+        } else {
+            ret = i2c_master_probe(s_bus, device->config.address, I2C_BUS_PROBE_TIMEOUT_MS);
+        }
+
+        if (ret != ESP_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Keeps the fastest speed at or below the ceiling that the device answers at. A device
+// that answers at none is left at the slowest speed, it may just not be connected yet.
+static esp_err_t _i2cbus_negotiate(i2cbus_device_t* device) {
+    for (size_t i = 0; i < I2C_BUS_SPEED_COUNT; i++) {
+        if (s_speeds[i] > device->ceiling_hz) {
+            continue;
+        }
+
+        esp_err_t ret = _i2cbus_set_speed(device, s_speeds[i]);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+
+        if (_i2cbus_probe(device)) {
+            ESP_LOGI(TAG, "%s (0x%02x) running at %" PRIu32 " Hz", device->config.name, device->config.address, s_speeds[i]);
+            return ESP_OK;
+        }
+    }
+
+    ESP_LOGW(TAG, "%s (0x%02x) not responding", device->config.name, device->config.address);
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Only blames the clock if the device still answers one step slower, otherwise an
+// unplugged device would drag its ceiling down to the minimum
+static void _i2cbus_fall_back(i2cbus_device_t* device) {
+    uint32_t current = device->stats.scl_hz;
+    uint32_t lower   = 0;
+
+    for (size_t i = 0; i < I2C_BUS_SPEED_COUNT; i++) {
+        if (s_speeds[i] < current) {
+            lower = s_speeds[i];
+            break;
+        }
+    }
+
+    if (lower == 0) {
+        return;
+    }
+
+    if (_i2cbus_set_speed(device, lower) == ESP_OK && _i2cbus_probe(device)) {
+        device->ceiling_hz = lower;
+
+        portENTER_CRITICAL(&s_stats_lock);
+        device->stats.fallbacks++;
+        portEXIT_CRITICAL(&s_stats_lock);
+
+        ESP_LOGW(TAG, "%s (0x%02x) falling back to %" PRIu32 " Hz", device->config.name, device->config.address, lower);
+        return;
+    }
+
+    _i2cbus_set_speed(device, current);
+}
+
+esp_err_t i2cbus_attach(const i2cbus_device_config_t* config, i2cbus_device_t** device) {
+    if (config == NULL || device == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    _i2cbus_lock();
+
+    esp_err_t ret = ESP_OK;
+    if (s_device_count == I2C_BUS_MAX_DEVICES) {
+        ESP_LOGE(TAG, "No room on I2C bus for %s", config->name);
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    i2cbus_device_t* dev = NULL;
+    if (ret == ESP_OK) {
+        dev = &s_devices[s_device_count];
+        memset(dev, 0, sizeof(*dev));
+
+        dev->config        = *config;
+        dev->ceiling_hz    = config->max_scl_hz > 0 ? config->max_scl_hz : s_speeds[0];
+        dev->stats.name    = config->name;
+        dev->stats.address = config->address;
+
+        ret = _i2cbus_set_speed(dev, I2C_BUS_MIN_FREQ_HZ);
+    }
+
+    if (ret == ESP_OK) {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_device_count++;
+        portEXIT_CRITICAL(&s_stats_lock);
+
+        // A device that doesn't answer yet stays attached, its driver negotiates again later
+        _i2cbus_negotiate(dev);
+        *device = dev;
+    }
+
+    _i2cbus_unlock();
+    return ret;
+}
+
+esp_err_t i2cbus_negotiate(i2cbus_device_t* device) {
+    if (device == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    _i2cbus_lock();
+    esp_err_t ret = _i2cbus_negotiate(device);
+    _i2cbus_unlock();
+    return ret;
+}
+
+esp_err_t i2cbus_transmit(i2cbus_device_t* device, const uint8_t* data, size_t len, int timeout_ms) {
+    if (device == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    _i2cbus_lock();
+
+    if (device->handle == NULL) {
+        _i2cbus_unlock();
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit(device->handle, data, len, timeout_ms);
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    portENTER_CRITICAL(&s_stats_lock);
+    device->stats.transactions++;
+    device->stats.busy_us += elapsed;
+    if (ret == ESP_OK) {
+        device->stats.bytes += len;
+    } else {
+        device->stats.errors++;
+        if (ret == ESP_ERR_TIMEOUT) {
+            device->stats.timeouts++;
+        }
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (ret == ESP_OK) {
+        device->consecutive_errors = 0;
+        _i2cbus_unlock();
+        return ESP_OK;
+    }
+
+    // A transfer cut short can leave a slave holding SDA low
+    if (ret == ESP_ERR_TIMEOUT) {
+        i2c_master_bus_reset(s_bus);
+    }
+
+    if (++device->consecutive_errors >= I2C_BUS_FALLBACK_ERRORS) {
+        device->consecutive_errors = 0;
+        _i2cbus_fall_back(device);
+    }
+
+    _i2cbus_unlock();
+    return ret;
+}
+
+uint32_t i2cbus_speed(const i2cbus_device_t* device) {
+    return device->stats.scl_hz;
+}
+
+size_t i2cbus_get_stats(i2cbus_stats_t* stats, size_t max_devices) {
+    portENTER_CRITICAL(&s_stats_lock);
+    size_t count = s_device_count < max_devices ? s_device_count : max_devices;
+    for (size_t i = 0; i < count; i++) {
+        stats[i] = s_devices[i].stats;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return count;
+}
@@ -0,0 +1,64 @@
+// i2cbus.h
+
+#pragma once
+
+#include "driver/i2c_master.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define I2C_BUS_SDA_IO              GPIO_NUM_21
+#define I2C_BUS_SCL_IO              GPIO_NUM_22
+#define I2C_BUS_NUM                 I2C_NUM_0
+
+#define I2C_BUS_MAX_DEVICES         4
+#define I2C_BUS_MIN_FREQ_HZ         100000
+
+// A speed is only kept if this many probe writes in a row succeed at it
+#define I2C_BUS_PROBE_ATTEMPTS      3
+#define I2C_BUS_PROBE_TIMEOUT_MS    50
+
+// Consecutive failed transfers before the device is re-probed at a lower speed
+#define I2C_BUS_FALLBACK_ERRORS     3
+
+typedef struct {
+    const char* name;
+    uint16_t address;
+    uint32_t scl_hz;
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t errors;
+    uint32_t timeouts;
+    uint32_t fallbacks;
+    uint64_t busy_us;
+} i2cbus_stats_t;
+
+// probe_data is written to the device while negotiating its speed, so it has to be
+// harmless and outlive the device. Without it only the address ACK is checked, which says
+// little about speed. A max_scl_hz of 0 lets the device run as fast as it answers.
+typedef struct {
+    const char* name;
+    uint16_t address;
+    uint32_t max_scl_hz;
+    const uint8_t* probe_data;
+    size_t probe_len;
+} i2cbus_device_config_t;
+
+// Owned by the task that attached it, transfers on one device must not run concurrently
+typedef struct {
+    i2cbus_device_config_t config;
+    i2c_master_dev_handle_t handle;
+    uint32_t ceiling_hz;
+    uint8_t consecutive_errors;
+    i2cbus_stats_t stats;
+} i2cbus_device_t;
+
+// Creates the bus and its lock, call once before any driver task attaches a device
+esp_err_t i2cbus_init(void);
+esp_err_t i2cbus_attach(const i2cbus_device_config_t* config, i2cbus_device_t** device);
+esp_err_t i2cbus_negotiate(i2cbus_device_t* device);
+esp_err_t i2cbus_transmit(i2cbus_device_t* device, const uint8_t* data, size_t len, int timeout_ms);
+
+uint32_t i2cbus_speed(const i2cbus_device_t* device);
+size_t i2cbus_get_stats(i2cbus_stats_t* stats, size_t max_devices);
@@ -0,0 +1,51 @@
+// ir_capture.c
+
+#include "ir_capture.h"
+#include "ir_frame_ring.h"
+#include "esp_log.h"
+#include "freertos/semphr.h"
+
+static const char* TAG = "IR_CAPTURE";
+
+ir_frame_ring_t ir_capture_ring;
+
+static SemaphoreHandle_t frame_ready = NULL;
+static bool holding_slot = false;
+
+esp_err_t ir_capture_init(void) {
+    frame_ready = xSemaphoreCreateBinary();
+    if (frame_ready == NULL) {
+        ESP_LOGE(TAG, "FAILED TO CREATE SEMAPHORE");
+        return ESP_ERR_NO_MEM;
+    }
+    return ir_capture_backend_init();
+}
+
+void IRAM_ATTR ir_capture_signal_from_isr(BaseType_t* higher_priority_task) {
+    xSemaphoreGiveFromISR(frame_ready, higher_priority_task);
+}
+
+// Several frames can be published per wakeup, so the ring is drained before waiting again
+size_t ir_capture_wait(const uint32_t** durations, TickType_t timeout) {
+    if (holding_slot) {
+        ir_frame_ring_release(&ir_capture_ring);
+        holding_slot = false;
+    }
+
+    const ir_ring_slot_t* slot;
+    while ((slot = ir_frame_ring_peek(&ir_capture_ring)) == NULL) {
+        if (xSemaphoreTake(frame_ready, timeout) != pdTRUE) {
+            return 0;
+        }
+    }
+
+    holding_slot = true;
+    *durations   = slot->durations;
+    return slot->len;
+}
+
+void ir_capture_get_stats(ir_capture_stats_t* stats) {
+    stats->frames           = atomic_load(&ir_capture_ring.frames);
+    stats->dropped_full     = atomic_load(&ir_capture_ring.dropped_full);
+    stats->dropped_overflow = atomic_load(&ir_capture_ring.dropped_overflow);
+}
@@ -0,0 +1,37 @@
+// ir_capture.h
+
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// 1 receives whole frames with the RMT peripheral, one interrupt per frame.
+// 0 timestamps every edge from a GPIO interrupt with the gptimer.
+#ifndef IR_CAPTURE_USE_RMT
+#define IR_CAPTURE_USE_RMT 1
+#endif
+
+#define IR_RMT_RESOLUTION_HZ 1000000
+#define IR_RMT_SYMBOLS 64
+// Shorter pulses are dropped by the RMT input filter as glitches
+#define IR_RMT_MIN_PULSE_NS 1250
+
+typedef struct {
+    uint32_t frames;
+    uint32_t dropped_full;
+    uint32_t dropped_overflow;
+} ir_capture_stats_t;
+
+esp_err_t ir_capture_init(void);
+
+// Blocks until a frame arrives or the timeout passes, returning 0 on timeout. durations
+// alternate mark and space in microseconds, starting with a mark, and stay valid until
+// the next call.
+size_t ir_capture_wait(const uint32_t** durations, TickType_t timeout);
+void ir_capture_get_stats(ir_capture_stats_t* stats);
+
+// Implemented by the selected backend, which fills frames into the ring from its ISR
+esp_err_t ir_capture_backend_init(void);
+void ir_capture_signal_from_isr(BaseType_t* higher_priority_task);
@@ -0,0 +1,119 @@
+// ir_capture_gpio.c
+
+#include "ir_capture.h"
+
+#if !IR_CAPTURE_USE_RMT
+
+#include "irdecoder.h"
+#include "ir_frame_ring.h"
+#include "driver/gpio.h"
+#include "driver/gptimer.h"
+#include "esp_log.h"
+
+static const char* TAG = "IR_CAPTURE";
+
+// Producer state, shared by the edge ISR and the alarm ISR. The lock keeps the two apart
+// should they ever run on different cores.
+static portMUX_TYPE capture_lock    = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t last_time           = 0;
+static ir_ring_slot_t* active_slot  = NULL;
+static bool overflowed              = false;
+
+gptimer_handle_t GPtimer;
+
+// Returns true if a frame was published and the decoder needs waking
+static bool IRAM_ATTR _ir_end_frame(void) {
+    bool published = false;
+
+    if (active_slot != NULL && active_slot->len > 0) {
+        if (overflowed) {
+            ir_frame_ring_drop(&ir_capture_ring.dropped_overflow);
+        } else {
+            ir_frame_ring_publish(&ir_capture_ring);
+            published = true;
+        }
+    }
+
+    active_slot = NULL;
+    overflowed  = false;
+    last_time   = 0;
+    return published;
+}
+
+static void IRAM_ATTR gpio_isr_handler(void* arg) {
+    uint64_t curr_time;
+    gptimer_get_raw_count(GPtimer, &curr_time);
+
+    // Every edge pushes the end of the frame one frame gap further out
+    gptimer_alarm_config_t alarm_config = {
+        .alarm_count = curr_time + IR_FRAME_GAP_US,
+    };
+    gptimer_set_alarm_action(GPtimer, &alarm_config);
+
+    portENTER_CRITICAL_ISR(&capture_lock);
+    if (last_time == 0) {
+        // First edge of a frame. With every slot still queued the whole frame is dropped.
+        active_slot = ir_frame_ring_claim(&ir_capture_ring);
+        if (active_slot == NULL) {
+            ir_frame_ring_drop(&ir_capture_ring.dropped_full);
+        } else {
+            active_slot->len = 0;
+        }
+    } else if (active_slot != NULL) {
+        if (active_slot->len < IR_TIMES_SIZE) {
+            active_slot->durations[active_slot->len++] = curr_time - last_time;
+        } else {
+            overflowed = true;
+        }
+    }
+    last_time = curr_time;
+    portEXIT_CRITICAL_ISR(&capture_lock);
+}
+
+static bool IRAM_ATTR ir_alarm_callback(gptimer_handle_t timer, const gptimer_alarm_event_data_t* edata, void* user_ctx) {
+    bool published = false;
+
+    // An edge may have moved the deadline while this alarm was already pending
+    portENTER_CRITICAL_ISR(&capture_lock);
+    if (last_time != 0 && edata->count_value - last_time >= IR_FRAME_GAP_US) {
+        published = _ir_end_frame();
+    }
+    portEXIT_CRITICAL_ISR(&capture_lock);
+
+    BaseType_t higher_priority_task = pdFALSE;
+    if (published) {
+        ir_capture_signal_from_isr(&higher_priority_task);
+    }
+    return higher_priority_task == pdTRUE;
+}
+
+esp_err_t ir_capture_backend_init(void) {
+    gpio_reset_pin(IR_PIN);
+    gpio_set_direction(IR_PIN, GPIO_MODE_INPUT);
+    gpio_set_intr_type(IR_PIN, GPIO_INTR_ANYEDGE);
+
+    gptimer_config_t timer_config = {
+        .clk_src       = GPTIMER_CLK_SRC_DEFAULT,
+        .direction     = GPTIMER_COUNT_UP,
+        .resolution_hz = 1 * 1000 * 1000};
+
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_config, &GPtimer));
+
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = ir_alarm_callback,
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(GPtimer, &callbacks, NULL));
+
+    esp_err_t isr_service_result = gpio_install_isr_service(0);
+    if (isr_service_result != ESP_OK && isr_service_result != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "FAILED TO INSTALL ISR SERVICE: %s", esp_err_to_name(isr_service_result));
+        return isr_service_result;
+    }
+    ESP_ERROR_CHECK(gpio_isr_handler_add(IR_PIN, gpio_isr_handler, NULL));
+
+    gptimer_enable(GPtimer);
+    gptimer_start(GPtimer);
+    return ESP_OK;
+}
+
+#endif
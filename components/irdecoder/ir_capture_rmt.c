@@ -0,0 +1,86 @@
+// ir_capture_rmt.c
+
+#include "ir_capture.h"
+
+#if IR_CAPTURE_USE_RMT
+
+#include "irdecoder.h"
+#include "ir_frame_ring.h"
+#include "driver/rmt_rx.h"
+#include "esp_log.h"
+
+static const char* TAG = "IR_CAPTURE";
+
+// The RMT ends a frame on its own once the line idles for a frame gap, so the whole
+// frame costs one interrupt and no software timeout
+static rmt_channel_handle_t rx_channel = NULL;
+static rmt_symbol_word_t rx_symbols[IR_RMT_SYMBOLS];
+
+// Read from the ISR, so kept in DRAM rather than flash
+static rmt_receive_config_t rx_config = {
+    .signal_range_min_ns = IR_RMT_MIN_PULSE_NS,
+    .signal_range_max_ns = IR_FRAME_GAP_US * 1000,
+};
+
+// A zero duration marks where the idle threshold ended the frame. Without one the symbol
+// buffer filled up first and the frame is incomplete.
+static bool IRAM_ATTR _ir_copy_symbols(const rmt_rx_done_event_data_t* edata, ir_ring_slot_t* slot) {
+    slot->len = 0;
+    for (size_t i = 0; i < edata->num_symbols && slot->len + 2 <= IR_TIMES_SIZE; i++) {
+        const rmt_symbol_word_t* symbol = &edata->received_symbols[i];
+        if (symbol->duration0 == 0) {
+            return true;
+        }
+        slot->durations[slot->len++] = symbol->duration0;
+        if (symbol->duration1 == 0) {
+            return true;
+        }
+        slot->durations[slot->len++] = symbol->duration1;
+    }
+    return false;
+}
+
+static bool IRAM_ATTR rmt_rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t* edata, void* user_ctx) {
+    BaseType_t higher_priority_task = pdFALSE;
+
+    // A glitch the input filter ate whole ends a frame with no symbols. It is left
+    // unpublished, the decoder would take a zero length as a timeout and release the key.
+    ir_ring_slot_t* slot = ir_frame_ring_claim(&ir_capture_ring);
+    if (slot == NULL) {
+        ir_frame_ring_drop(&ir_capture_ring.dropped_full);
+    } else if (!_ir_copy_symbols(edata, slot)) {
+        ir_frame_ring_drop(&ir_capture_ring.dropped_overflow);
+    } else if (slot->len > 0) {
+        ir_frame_ring_publish(&ir_capture_ring);
+        ir_capture_signal_from_isr(&higher_priority_task);
+    }
+
+    // The symbols are copied out, so the receiver is re-armed before the decoder even runs
+    rmt_receive(channel, rx_symbols, sizeof(rx_symbols), &rx_config);
+    return higher_priority_task == pdTRUE;
+}
+
+esp_err_t ir_capture_backend_init(void) {
+    rmt_rx_channel_config_t channel_config = {
+        .clk_src           = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz     = IR_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = IR_RMT_SYMBOLS,
+        .gpio_num          = IR_PIN,
+    };
+
+    esp_err_t ret = rmt_new_rx_channel(&channel_config, &rx_channel);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "FAILED TO CREATE RMT RX CHANNEL: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    rmt_rx_event_callbacks_t callbacks = {
+        .on_recv_done = rmt_rx_done_callback,
+    };
+    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rx_channel, &callbacks, NULL));
+    ESP_ERROR_CHECK(rmt_enable(rx_channel));
+
+    return rmt_receive(rx_channel, rx_symbols, sizeof(rx_symbols), &rx_config);
+}
+
+#endif
@@ -0,0 +1,65 @@
+// ir_frame_ring.h
+
+#pragma once
+
+#include "irdecoder.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Power of two, so the free-running indices wrap cleanly
+#define IR_RING_SLOTS 8
+
+typedef struct {
+    uint16_t len;
+    uint32_t durations[IR_TIMES_SIZE];
+} ir_ring_slot_t;
+
+// Single producer (the capture ISR) and single consumer (the decoder task). Each side only
+// writes its own index, so neither needs a lock. The producer fills the slot at head in
+// place and publishes it, the consumer keeps the slot at tail until it releases it.
+typedef struct {
+    ir_ring_slot_t slots[IR_RING_SLOTS];
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_uint frames;
+    atomic_uint dropped_full;
+    atomic_uint dropped_overflow;
+} ir_frame_ring_t;
+
+// Returns NULL while every slot is still waiting for the consumer
+static inline ir_ring_slot_t* ir_frame_ring_claim(ir_frame_ring_t* ring) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == IR_RING_SLOTS) {
+        return NULL;
+    }
+    return &ring->slots[head % IR_RING_SLOTS];
+}
+
+static inline void ir_frame_ring_publish(ir_frame_ring_t* ring) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->frames, 1, memory_order_relaxed);
+}
+
+static inline void ir_frame_ring_drop(atomic_uint* counter) {
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+static inline const ir_ring_slot_t* ir_frame_ring_peek(ir_frame_ring_t* ring) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+    return &ring->slots[tail % IR_RING_SLOTS];
+}
+
+static inline void ir_frame_ring_release(ir_frame_ring_t* ring) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+// Shared by the capture backend (producer) and ir_capture_wait() (consumer)
+extern ir_frame_ring_t ir_capture_ring;
@@ -0,0 +1,203 @@
+// ir_protocol.c
+
+#include "ir_protocol.h"
+
+// Each decoder checks the leader first and returns false if the frame isn't its protocol.
+// Once it claims a frame it owns the result, even if the bits turn out to be bad.
+typedef bool (*ir_decoder_t)(const uint32_t* durations, size_t len, ir_frame_t* frame);
+
+typedef struct {
+    ir_protocol_id_t id;
+    const char* name;
+    ir_decoder_t decode;
+} ir_protocol_t;
+
+// Constant marks with the bit in the space after each one. Bits are shifted in MSB
+// first, which is the order the keymap codes were captured in.
+static bool _ir_decode_pulse_distance(const uint32_t* durations, size_t len, uint32_t* data) {
+    if (len < 2 + NEC_BITS * 2) {
+        return false;
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < NEC_BITS; i++) {
+        uint32_t pulse = durations[i * 2 + 2];
+        uint32_t space = durations[i * 2 + 3];
+
+        if (!IR_MATCH(pulse, NEC_BIT_PULSE)) {
+            return false;
+        }
+
+        bits <<= 1;
+        if (IR_MATCH(space, NEC_ONE_SPACE)) {
+            bits |= 1;
+        } else if (!IR_MATCH(space, NEC_ZERO_SPACE)) {
+            return false;
+        }
+    }
+
+    *data = bits;
+    return true;
+}
+
+// Standard NEC sends the address and its inverse. Extended NEC spends the inverse byte
+// on a 16-bit address, so an address that fails the check is read that way instead.
+static bool _ir_decode_nec(const uint32_t* durations, size_t len, ir_frame_t* frame) {
+    if (len < 2 || !IR_MATCH(durations[0], NEC_START_PULSE)) {
+        return false;
+    }
+
+    if (IR_MATCH(durations[1], NEC_REPEAT_SPACE)) {
+        frame->type     = IR_FRAME_TYPE_REPEAT;
+        frame->protocol = IR_PROTOCOL_NEC;
+        return true;
+    }
+
+    if (!IR_MATCH(durations[1], NEC_START_SPACE)) {
+        return false;
+    }
+    frame->protocol = IR_PROTOCOL_NEC;
+
+    uint32_t data;
+    if (!_ir_decode_pulse_distance(durations, len, &data)) {
+        return true;
+    }
+
+    uint8_t addr     = (data >> 24) & 0xFF;
+    uint8_t inv_addr = (data >> 16) & 0xFF;
+    uint8_t cmd      = (data >> 8) & 0xFF;
+    uint8_t inv_cmd  = data & 0xFF;
+
+    if ((cmd ^ inv_cmd) != 0xFF) {
+        return true;
+    }
+
+    if ((addr ^ inv_addr) == 0xFF) {
+        frame->address = addr;
+    } else {
+        frame->protocol = IR_PROTOCOL_NEC_EXTENDED;
+        frame->address  = (addr << 8) | inv_addr;
+    }
+
+    frame->type    = IR_FRAME_TYPE_DATA;
+    frame->command = cmd;
+    return true;
+}
+
+// Samsung repeats the address byte instead of inverting it, held keys resend whole frames
+static bool _ir_decode_samsung(const uint32_t* durations, size_t len, ir_frame_t* frame) {
+    if (len < 2 || !IR_MATCH(durations[0], SAMSUNG_START_PULSE) || !IR_MATCH(durations[1], SAMSUNG_START_SPACE)) {
+        return false;
+    }
+    frame->protocol = IR_PROTOCOL_SAMSUNG;
+
+    uint32_t data;
+    if (!_ir_decode_pulse_distance(durations, len, &data)) {
+        return true;
+    }
+
+    uint8_t addr    = (data >> 24) & 0xFF;
+    uint8_t addr2   = (data >> 16) & 0xFF;
+    uint8_t cmd     = (data >> 8) & 0xFF;
+    uint8_t inv_cmd = data & 0xFF;
+
+    if ((cmd ^ inv_cmd) != 0xFF) {
+        return true;
+    }
+
+    frame->type    = IR_FRAME_TYPE_DATA;
+    frame->address = addr == addr2 ? addr : (addr << 8) | addr2;
+    frame->command = cmd;
+    return true;
+}
+
+// Manchester coded, a 1 is space then mark. The first half of the start bit looks like
+// idle and is never captured, so it is put back before splitting into bits.
+static bool _ir_decode_rc5(const uint32_t* durations, size_t len, ir_frame_t* frame) {
+    if (len == 0 || len > RC5_BITS * 2 ||
+        (!IR_MATCH(durations[0], RC5_HALF_BIT) && !IR_MATCH(durations[0], 2 * RC5_HALF_BIT))) {
+        return false;
+    }
+    frame->protocol = IR_PROTOCOL_RC5;
+
+    uint32_t halves = 0;
+    int count = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        int width;
+        if (IR_MATCH(durations[i], RC5_HALF_BIT)) {
+            width = 1;
+        } else if (IR_MATCH(durations[i], 2 * RC5_HALF_BIT)) {
+            width = 2;
+        } else {
+            return true;
+        }
+
+        uint32_t mark = (i % 2 == 0) ? 1 : 0;
+        for (int k = 0; k < width; k++) {
+            halves = (halves << 1) | mark;
+            count++;
+        }
+        if (count > RC5_BITS * 2) {
+            return true;
+        }
+    }
+
+    // A trailing 0 ends in a space that runs into idle
+    if (count == RC5_BITS * 2 - 1) {
+        halves <<= 1;
+        count++;
+    }
+    if (count != RC5_BITS * 2) {
+        return true;
+    }
+
+    uint16_t data = 0;
+    for (int bit = 0; bit < RC5_BITS; bit++) {
+        uint32_t first  = (halves >> (RC5_BITS * 2 - 1 - bit * 2)) & 1;
+        uint32_t second = (halves >> (RC5_BITS * 2 - 2 - bit * 2)) & 1;
+        if (first == second) {
+            return true;
+        }
+        data = (data << 1) | second;
+    }
+
+    // Layout is S1 S2 T A4..A0 C5..C0, RC5X reuses an inverted S2 as command bit 6
+    frame->type    = IR_FRAME_TYPE_DATA;
+    frame->toggle  = (data >> 11) & 1;
+    frame->address = (data >> 6) & 0x1F;
+    frame->command = (data & 0x3F) | ((~data >> 6) & 0x40);
+    return true;
+}
+
+static const ir_protocol_t ir_protocols[] = {
+    {IR_PROTOCOL_NEC, "NEC", _ir_decode_nec},
+    {IR_PROTOCOL_SAMSUNG, "Samsung", _ir_decode_samsung},
+    {IR_PROTOCOL_RC5, "RC5", _ir_decode_rc5},
+};
+
+void ir_protocol_decode(const uint32_t* durations, size_t len, ir_frame_t* frame) {
+    frame->type     = IR_FRAME_TYPE_INVALID;
+    frame->protocol = IR_PROTOCOL_UNKNOWN;
+    frame->address  = 0;
+    frame->command  = 0;
+    frame->toggle   = 0;
+
+    for (size_t i = 0; i < sizeof(ir_protocols) / sizeof(ir_protocols[0]); i++) {
+        if (ir_protocols[i].decode(durations, len, frame)) {
+            return;
+        }
+    }
+}
+
+const char* ir_protocol_name(ir_protocol_id_t protocol) {
+    if (protocol == IR_PROTOCOL_NEC_EXTENDED) {
+        return "NEC extended";
+    }
+    for (size_t i = 0; i < sizeof(ir_protocols) / sizeof(ir_protocols[0]); i++) {
+        if (ir_protocols[i].id == protocol) {
+            return ir_protocols[i].name;
+        }
+    }
+    return "unknown";
+}
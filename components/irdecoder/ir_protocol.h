@@ -0,0 +1,55 @@
+// ir_protocol.h
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_TOLERANCE_PERCENT 30
+
+#define IR_MATCH(value, target)                                         \
+    ((value) >= ((target) - ((target) * IR_TOLERANCE_PERCENT / 100)) && \
+     (value) <= ((target) + ((target) * IR_TOLERANCE_PERCENT / 100)))
+
+#define NEC_START_PULSE 9000
+#define NEC_START_SPACE 4500
+#define NEC_REPEAT_SPACE 2250
+#define NEC_BIT_PULSE 560
+#define NEC_ZERO_SPACE 560
+#define NEC_ONE_SPACE 1690
+#define NEC_BITS 32
+
+// Samsung uses NEC bit timings behind a shorter leader
+#define SAMSUNG_START_PULSE 4500
+#define SAMSUNG_START_SPACE 4500
+
+#define RC5_HALF_BIT 889
+#define RC5_BITS 14
+
+typedef enum {
+    IR_FRAME_TYPE_DATA,
+    IR_FRAME_TYPE_REPEAT,
+    IR_FRAME_TYPE_INVALID,
+} ir_frame_type_t;
+
+typedef enum {
+    IR_PROTOCOL_UNKNOWN,
+    IR_PROTOCOL_NEC,
+    IR_PROTOCOL_NEC_EXTENDED,
+    IR_PROTOCOL_SAMSUNG,
+    IR_PROTOCOL_RC5,
+} ir_protocol_id_t;
+
+// toggle flips on every new RC5 key press and stays put while a key is held
+typedef struct {
+    ir_frame_type_t type;
+    ir_protocol_id_t protocol;
+    uint16_t address;
+    uint8_t command;
+    uint8_t toggle;
+} ir_frame_t;
+
+// durations alternate mark and space, starting with the first mark of the frame
+void ir_protocol_decode(const uint32_t* durations, size_t len, ir_frame_t* frame);
+const char* ir_protocol_name(ir_protocol_id_t protocol);
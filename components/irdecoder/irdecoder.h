@@ -2,29 +2,22 @@
 
 #pragma once
 
+#include "ir_protocol.h"
 #include <stdint.h>
 
 #define IR_PIN GPIO_NUM_14
 #define IR_TIMES_SIZE 128
 
-#define TIMEOUT_US 100000
+// Silence longer than this ends a frame
+#define IR_FRAME_GAP_US 15000
 
-#define NEC_START_PULSE 9000
-#define NEC_START_SPACE 4500
-#define NEC_BIT_PULSE 560
-#define NEC_ZERO_SPACE 560
-#define NEC_ONE_SPACE 1690
-#define NEC_TOLERANCE_PERCENT 30
-
-#define IR_MATCH(value, target)                                          \
-    ((value) >= ((target) - ((target) * NEC_TOLERANCE_PERCENT / 100)) && \
-     (value) <= ((target) + ((target) * NEC_TOLERANCE_PERCENT / 100)))
-
-typedef enum {
-    IR_FRAME_TYPE_DATA,
-    IR_FRAME_TYPE_REPEAT,
-    IR_FRAME_TYPE_INVALID,
-} ir_frame_type_t;
+// Remotes resend a held key about every 110 ms, a key not seen for longer is released
+#define IR_KEY_RELEASE_TIMEOUT_MS 200
+#define IR_KEY_REPEAT_DELAY_MS 400
+#define IR_KEY_REPEAT_INTERVAL_MS 250
+#define IR_KEY_REPEAT_MIN_INTERVAL_MS 80
+#define IR_KEY_REPEAT_ACCEL_PERCENT 20
+#define IR_KEY_LONG_PRESS_MS 1000
 
 typedef enum {
     BUTTON_0                = 0x68,
@@ -52,10 +45,8 @@ typedef enum {
 } button_press_t;
 
 typedef struct {
-    ir_frame_type_t type;
+    ir_frame_t frame;
     button_press_t button;
-    uint8_t address;
-    uint8_t command;
 } ir_result_t;
 
 void ir_decode_task(void* pvParameters);
\ No newline at end of file
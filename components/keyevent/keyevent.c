@@ -0,0 +1,151 @@
+// keyevent.c
+
+#include "keyevent.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char* TAG = "KEY_EVENT";
+
+// Subscribers are only ever added, and may subscribe before any source starts
+static QueueHandle_t s_subscribers[KEY_EVENT_MAX_SUBSCRIBERS];
+static size_t s_num_subscribers = 0;
+static portMUX_TYPE s_subscribers_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void _key_event_publish(const key_engine_t* engine, key_event_type_t type, int64_t now) {
+    key_event_t event = {
+        .source       = engine->source,
+        .type         = type,
+        .code         = engine->code,
+        .repeat_count = engine->repeats,
+        .held_ms      = (uint32_t)((now - engine->pressed_us) / 1000),
+        .long_press   = engine->long_sent,
+    };
+
+    portENTER_CRITICAL(&s_subscribers_lock);
+    size_t count = s_num_subscribers;
+    portEXIT_CRITICAL(&s_subscribers_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        if (xQueueSend(s_subscribers[i], &event, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "Subscriber %u queue full, key event dropped", (unsigned)i);
+        }
+    }
+}
+
+static void _key_engine_up(key_engine_t* engine, int64_t now) {
+    _key_event_publish(engine, KEY_EVENT_RELEASE, now);
+    engine->down = false;
+}
+
+void key_engine_init(key_engine_t* engine, key_source_t source, const key_engine_config_t* config) {
+    memset(engine, 0, sizeof(*engine));
+    engine->config = *config;
+    engine->source = source;
+}
+
+void key_engine_press(key_engine_t* engine, uint16_t code) {
+    int64_t now = esp_timer_get_time();
+
+    // A different key can arrive before the release timeout of the last one
+    if (engine->down) {
+        _key_engine_up(engine, now);
+    }
+
+    engine->down           = true;
+    engine->long_sent      = false;
+    engine->code           = code;
+    engine->repeats        = 0;
+    engine->interval_ms    = engine->config.repeat_interval_ms;
+    engine->pressed_us     = now;
+    engine->last_seen_us   = now;
+    engine->next_repeat_us = now + (int64_t)engine->config.repeat_delay_ms * 1000;
+
+    _key_event_publish(engine, KEY_EVENT_PRESS, now);
+}
+
+void key_engine_hold(key_engine_t* engine) {
+    if (engine->down) {
+        engine->last_seen_us = esp_timer_get_time();
+    }
+}
+
+void key_engine_release(key_engine_t* engine) {
+    if (engine->down) {
+        _key_engine_up(engine, esp_timer_get_time());
+    }
+}
+
+bool key_engine_is_down(const key_engine_t* engine, uint16_t code) {
+    return engine->down && engine->code == code;
+}
+
+TickType_t key_engine_poll(key_engine_t* engine) {
+    if (!engine->down) {
+        return portMAX_DELAY;
+    }
+
+    const key_engine_config_t* config = &engine->config;
+    int64_t now = esp_timer_get_time();
+
+    if (config->release_timeout_ms > 0) {
+        int64_t release_at = engine->last_seen_us + (int64_t)config->release_timeout_ms * 1000;
+        if (now >= release_at) {
+            _key_engine_up(engine, now);
+            return portMAX_DELAY;
+        }
+    }
+
+    int64_t long_press_at = engine->pressed_us + (int64_t)config->long_press_ms * 1000;
+    if (config->long_press_ms > 0 && !engine->long_sent && now >= long_press_at) {
+        engine->long_sent = true;
+        _key_event_publish(engine, KEY_EVENT_LONG_PRESS, now);
+    }
+
+    // Catching up after a late poll would only burst repeats, so at most one per poll
+    if (config->repeat_delay_ms > 0 && now >= engine->next_repeat_us) {
+        engine->repeats++;
+        _key_event_publish(engine, KEY_EVENT_REPEAT, now);
+
+        engine->next_repeat_us = now + (int64_t)engine->interval_ms * 1000;
+        uint32_t next_interval = engine->interval_ms * (100 - config->repeat_accel_percent) / 100;
+        engine->interval_ms    = next_interval > config->repeat_min_interval_ms ? next_interval : config->repeat_min_interval_ms;
+    }
+
+    int64_t deadline = INT64_MAX;
+    if (config->release_timeout_ms > 0) {
+        deadline = engine->last_seen_us + (int64_t)config->release_timeout_ms * 1000;
+    }
+    if (config->long_press_ms > 0 && !engine->long_sent && long_press_at < deadline) {
+        deadline = long_press_at;
+    }
+    if (config->repeat_delay_ms > 0 && engine->next_repeat_us < deadline) {
+        deadline = engine->next_repeat_us;
+    }
+
+    if (deadline == INT64_MAX) {
+        return portMAX_DELAY;
+    }
+
+    // Round up so the next poll never lands just short of the deadline
+    int64_t wait_ms = deadline > now ? (deadline - now + 999) / 1000 : 0;
+    return pdMS_TO_TICKS(wait_ms) + 1;
+}
+
+esp_err_t key_event_subscribe(QueueHandle_t queue) {
+    if (queue == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&s_subscribers_lock);
+    if (s_num_subscribers < KEY_EVENT_MAX_SUBSCRIBERS) {
+        s_subscribers[s_num_subscribers++] = queue;
+    } else {
+        ret = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&s_subscribers_lock);
+
+    return ret;
+}
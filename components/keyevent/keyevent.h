@@ -0,0 +1,72 @@
+// keyevent.h
+
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KEY_EVENT_MAX_SUBSCRIBERS 4
+
+typedef enum {
+    KEY_SOURCE_IR,
+    KEY_SOURCE_BUTTON,
+} key_source_t;
+
+typedef enum {
+    KEY_EVENT_PRESS,
+    KEY_EVENT_REPEAT,
+    KEY_EVENT_LONG_PRESS,
+    KEY_EVENT_RELEASE,
+} key_event_type_t;
+
+// long_press tells REPEAT and RELEASE events whether the long press already fired
+typedef struct {
+    key_source_t source;
+    key_event_type_t type;
+    uint16_t code;
+    uint16_t repeat_count;
+    uint32_t held_ms;
+    bool long_press;
+} key_event_t;
+
+// Auto-repeat starts after repeat_delay_ms and every repeat shortens the interval by
+// repeat_accel_percent, down to repeat_min_interval_ms. A repeat_delay_ms or long_press_ms
+// of 0 disables that event. Sources that can't report a release (IR) set
+// release_timeout_ms, a key not seen for that long counts as released.
+typedef struct {
+    uint32_t repeat_delay_ms;
+    uint32_t repeat_interval_ms;
+    uint32_t repeat_min_interval_ms;
+    uint8_t repeat_accel_percent;
+    uint32_t long_press_ms;
+    uint32_t release_timeout_ms;
+} key_engine_config_t;
+
+// One engine per input source, driven from that source's task only
+typedef struct {
+    key_engine_config_t config;
+    key_source_t source;
+    bool down;
+    bool long_sent;
+    uint16_t code;
+    uint16_t repeats;
+    uint32_t interval_ms;
+    int64_t pressed_us;
+    int64_t last_seen_us;
+    int64_t next_repeat_us;
+} key_engine_t;
+
+void key_engine_init(key_engine_t* engine, key_source_t source, const key_engine_config_t* config);
+void key_engine_press(key_engine_t* engine, uint16_t code);
+void key_engine_hold(key_engine_t* engine);
+void key_engine_release(key_engine_t* engine);
+bool key_engine_is_down(const key_engine_t* engine, uint16_t code);
+
+// Emits the events that are due and returns how long the caller may block before the next
+TickType_t key_engine_poll(key_engine_t* engine);
+
+// Events are copied into the queue without blocking, a full queue misses them
+esp_err_t key_event_subscribe(QueueHandle_t queue);
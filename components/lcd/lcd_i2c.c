@@ -6,68 +6,91 @@
 #include "freertos/task.h"
 #include "rom/ets_sys.h"
 #include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static const char* TAG = "LCD_I2C_DRIVER";
 
-static i2c_master_bus_handle_t _lcd_i2c_master_init(void) {
-    i2c_master_bus_config_t i2c_conf = {
-        .clk_source                   = I2C_CLK_SRC_DEFAULT,
-        .i2c_port                     = I2C_MASTER_NUM,
-        .scl_io_num                   = I2C_MASTER_SCL_IO,
-        .sda_io_num                   = I2C_MASTER_SDA_IO,
-        .glitch_ignore_cnt            = 7,
-        .flags.enable_internal_pullup = false,
-    };
-
-    i2c_master_bus_handle_t i2c_bus_handle;
-    ESP_ERROR_CHECK(i2c_new_master_bus(&i2c_conf, &i2c_bus_handle));
-    return i2c_bus_handle;
+// Sends everything queued so far as one I2C write. The PCF8574 latches every byte of a
+// multi-byte write onto its pins, so each byte is one step of the EN strobe sequence.
+static void _lcd_batch_send(lcd_i2c_handle_t* lcd) {
+    if (lcd->batch_len > 0 && lcd->batch_err == ESP_OK) {
+        lcd->batch_err = i2cbus_transmit(
+            lcd->dev,
+            lcd->batch,
+            lcd->batch_len,
+            LCD_I2C_TIMEOUT_MS);
+    }
+    lcd->batch_len = 0;
 }
 
-static esp_err_t _lcd_send_byte_i2c(lcd_i2c_handle_t* lcd, uint8_t val) {
-    uint8_t write_buffer[1] = {val};
-    ESP_ERROR_CHECK(i2c_master_transmit(
-        lcd->i2c_dev_handle,
-        write_buffer,
-        sizeof(write_buffer),
-        pdMS_TO_TICKS(1000)));
+// Returns the first error since the last flush. After a failed write the glass is in an
+// unknown state, so the shadow is invalidated and the next flush redraws everything.
+static esp_err_t _lcd_batch_flush(lcd_i2c_handle_t* lcd) {
+    _lcd_batch_send(lcd);
 
-    return ESP_OK;
+    esp_err_t ret  = lcd->batch_err;
+    lcd->batch_err = ESP_OK;
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "LCD write failed: %s", esp_err_to_name(ret));
+        memset(lcd->shadow, LCD_SHADOW_INVALID, sizeof(lcd->shadow));
+        lcd->cursor_col   = lcd->cols;
+        lcd->cgram_loaded = 0;
+    }
+    return ret;
 }
 
-static lcd_i2c_handle_t* _lcd_i2c_create(i2c_master_bus_handle_t i2c_bus_handle, uint8_t address, uint8_t cols, uint8_t rows) {
-    if (i2c_bus_handle == NULL) {
-        ESP_LOGE(TAG, "I2C BUS HANDLE IS NULL, CANNOT CREATE LCD");
-        return NULL;
+static void _lcd_batch_push(lcd_i2c_handle_t* lcd, uint8_t val) {
+    if (lcd->batch_len == LCD_BATCH_SIZE) {
+        _lcd_batch_send(lcd);
     }
+    lcd->batch[lcd->batch_len++] = val;
+}
 
-    i2c_device_config_t dev_cfg = {
-        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address  = address,
-        .scl_speed_hz    = I2C_MASTER_FREQ_HZ};
+// Bytes are 9 clocks on the bus, and the next EN falling edge is at least one byte away
+static uint8_t _lcd_exec_pad(uint32_t scl_hz) {
+    uint32_t byte_ns = 9 * (1000000000 / scl_hz);
+    uint32_t needed  = (LCD_EXEC_TIME_US * 1000 + byte_ns - 1) / byte_ns;
+    return needed > 1 ? needed - 1 : 0;
+}
 
-    i2c_master_dev_handle_t i2c_dev_handle = NULL;
-    ESP_ERROR_CHECK(i2c_master_bus_add_device(i2c_bus_handle, &dev_cfg, &i2c_dev_handle));
+static lcd_i2c_handle_t* _lcd_i2c_create(uint8_t address, uint8_t cols, uint8_t rows) {
+    // Backlight on with EN low, the controller ignores it while speeds are tried
+    static const uint8_t probe = PCF8574_BL;
+
+    i2cbus_device_config_t dev_cfg = {
+        .name       = "lcd",
+        .address    = address,
+        .max_scl_hz = LCD_I2C_MAX_FREQ_HZ,
+        .probe_data = &probe,
+        .probe_len  = sizeof(probe)};
+
+    i2cbus_device_t* dev = NULL;
+    esp_err_t ret = i2cbus_attach(&dev_cfg, &dev);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add LCD to I2C bus: %s", esp_err_to_name(ret));
+        return NULL;
+    }
 
     lcd_i2c_handle_t* lcd = (lcd_i2c_handle_t*)calloc(1, sizeof(lcd_i2c_handle_t));
     if (lcd == NULL) {
         ESP_LOGE(TAG, "Failed to allocate memory for LCD handle!");
-        i2c_master_bus_rm_device(i2c_dev_handle);
         return NULL;
     }
 
-    lcd->i2c_dev_handle  = i2c_dev_handle;
+    lcd->dev             = dev;
     lcd->cols            = cols;
     lcd->rows            = rows;
     lcd->backlight_state = 0;
+    memset(lcd->shadow, LCD_SHADOW_INVALID, sizeof(lcd->shadow));
 
     return lcd;
 }
 
-static esp_err_t _lcd_write_4bit_nibble(lcd_i2c_handle_t* lcd, uint8_t nibble, uint8_t mode) {
-    uint8_t data_to_send;
-
-    data_to_send = mode | lcd->backlight_state;
+static void _lcd_queue_nibble(lcd_i2c_handle_t* lcd, uint8_t nibble, uint8_t mode) {
+    uint8_t data_to_send = mode | lcd->backlight_state;
 
     if (nibble & 0b0001) {
         data_to_send |= PCF8574_D4;
@@ -85,66 +108,104 @@ static esp_err_t _lcd_write_4bit_nibble(lcd_i2c_handle_t* lcd, uint8_t nibble, u
         data_to_send |= PCF8574_D7;
     }
 
-    data_to_send |= PCF8574_EN;
-    ESP_ERROR_CHECK(_lcd_send_byte_i2c(lcd, data_to_send));
-    esp_rom_delay_us(1);
+    // One byte on the bus is far longer than the EN pulse width, no busy-wait needed
+    _lcd_batch_push(lcd, data_to_send | PCF8574_EN);
+    _lcd_batch_push(lcd, data_to_send);
+}
 
-    data_to_send &= ~PCF8574_EN;
-    ESP_ERROR_CHECK(_lcd_send_byte_i2c(lcd, data_to_send));
-    esp_rom_delay_us(50);
+static void _lcd_queue_byte(lcd_i2c_handle_t* lcd, uint8_t val, uint8_t mode) {
+    _lcd_queue_nibble(lcd, (val >> 4) & 0x0F, mode);
+    _lcd_queue_nibble(lcd, val & 0x0F, mode);
 
-    return ESP_OK;
+    // Idle bytes cover the execution time when the bus is faster than the controller
+    for (uint8_t i = 0; i < lcd->exec_pad; i++) {
+        _lcd_batch_push(lcd, mode | lcd->backlight_state);
+    }
 }
 
 static esp_err_t _lcd_send_cmd(lcd_i2c_handle_t* lcd, uint8_t cmd) {
-    ESP_ERROR_CHECK(_lcd_write_4bit_nibble(lcd, (cmd >> 4) & 0x0F, LCD_RS_COMMAND));
-    ESP_ERROR_CHECK(_lcd_write_4bit_nibble(lcd, cmd & 0x0F, LCD_RS_COMMAND));
+    _lcd_queue_byte(lcd, cmd, LCD_RS_COMMAND);
 
     if (cmd == LCD_CLEARDISPLAY || cmd == LCD_RETURNHOME) {
-        vTaskDelay(pdMS_TO_TICKS(2));
-    } else {
-        esp_rom_delay_us(50);
+        esp_err_t ret = _lcd_batch_flush(lcd);
+        esp_rom_delay_us(LCD_CLEAR_TIME_US);
+        return ret;
     }
 
     return ESP_OK;
 }
 
 static esp_err_t _lcd_send_data(lcd_i2c_handle_t* lcd, uint8_t data) {
-    ESP_ERROR_CHECK(_lcd_write_4bit_nibble(lcd, (data >> 4) & 0x0F, LCD_RS_DATA));
-    ESP_ERROR_CHECK(_lcd_write_4bit_nibble(lcd, data & 0x0F, LCD_RS_DATA));
-    esp_rom_delay_us(50);
+    _lcd_queue_byte(lcd, data, LCD_RS_DATA);
 
     return ESP_OK;
 }
 
-static void _lcd_init(lcd_i2c_handle_t* lcd) {
+static esp_err_t _lcd_write_4bit_nibble(lcd_i2c_handle_t* lcd, uint8_t nibble, uint8_t mode) {
+    _lcd_queue_nibble(lcd, nibble, mode);
+    return _lcd_batch_flush(lcd);
+}
+
+static esp_err_t _lcd_init(lcd_i2c_handle_t* lcd) {
     ESP_LOGI(TAG, "INITIALIZING LCD DISPLAY SEQUENCE");
     vTaskDelay(pdMS_TO_TICKS(50));
 
-    _lcd_write_4bit_nibble(lcd, 0x03, LCD_RS_COMMAND);
-    vTaskDelay(pdMS_TO_TICKS(5));
+    lcd->batch_len = 0;
+    lcd->batch_err = ESP_OK;
+    lcd->exec_pad  = _lcd_exec_pad(i2cbus_speed(lcd->dev));
+
+    // CGRAM contents are undefined after power-up
+    lcd->cgram_loaded = 0;
+
+    // The reset waits are below one tick at 100 Hz, where a vTaskDelay of them is 0 ticks
+    esp_err_t ret = _lcd_write_4bit_nibble(lcd, 0x03, LCD_RS_COMMAND);
+    esp_rom_delay_us(4500);
+
+    if (ret == ESP_OK) {
+        ret = _lcd_write_4bit_nibble(lcd, 0x03, LCD_RS_COMMAND);
+        esp_rom_delay_us(150);
+    }
+
+    if (ret == ESP_OK) {
+        ret = _lcd_write_4bit_nibble(lcd, 0x03, LCD_RS_COMMAND);
+        esp_rom_delay_us(1000);
+    }
 
-    _lcd_write_4bit_nibble(lcd, 0x03, LCD_RS_COMMAND);
-    esp_rom_delay_us(150);
+    if (ret == ESP_OK) {
+        ret = _lcd_write_4bit_nibble(lcd, 0x02, LCD_RS_COMMAND);
+        esp_rom_delay_us(100);
+    }
 
-    _lcd_write_4bit_nibble(lcd, 0x03, LCD_RS_COMMAND);
-    vTaskDelay(pdMS_TO_TICKS(1));
+    if (ret == ESP_OK) {
+        _lcd_send_cmd(lcd, LCD_FUNCTIONSET | LCD_4BITMODE | LCD_2LINE | LCD_5x8DOTS);
+        _lcd_send_cmd(lcd, LCD_DISPLAYMODECONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF);
+        _lcd_send_cmd(lcd, LCD_CLEARDISPLAY);
 
-    _lcd_write_4bit_nibble(lcd, 0x02, LCD_RS_COMMAND);
-    esp_rom_delay_us(100);
+        _lcd_send_cmd(lcd, LCD_ENTRYMODESET | LCD_ENTRYSHIFTINCREMENT);
+        _lcd_send_cmd(lcd, LCD_RETURNHOME);
 
-    _lcd_send_cmd(lcd, LCD_FUNCTIONSET | LCD_4BITMODE | LCD_2LINE | LCD_5x8DOTS);
-    _lcd_send_cmd(lcd, LCD_DISPLAYMODECONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF);
-    _lcd_send_cmd(lcd, LCD_CLEARDISPLAY);
+        ret = _lcd_batch_flush(lcd);
+    }
 
-    _lcd_send_cmd(lcd, LCD_ENTRYMODESET | LCD_ENTRYSHIFTINCREMENT);
-    _lcd_send_cmd(lcd, LCD_RETURNHOME);
+    if (ret == ESP_OK) {
+        ret = lcd_i2c_backlight(lcd, true);
+    }
+
+    lcd->ready = (ret == ESP_OK);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "LCD INITIALIZING SEQUENCE FAILED: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    memset(lcd->shadow, ' ', sizeof(lcd->shadow));
+    lcd->cursor_col = 0;
+    lcd->cursor_row = 0;
 
-    lcd_i2c_backlight(lcd, true);
     ESP_LOGI(TAG, "LCD INITIALIZING SEQUENCE COMPLETE");
+    return ESP_OK;
 }
 
-void lcd_i2c_backlight(lcd_i2c_handle_t* lcd, bool on) {
+esp_err_t lcd_i2c_backlight(lcd_i2c_handle_t* lcd, bool on) {
     uint8_t data_to_send = 0;
 
     if (on) {
@@ -155,7 +216,8 @@ void lcd_i2c_backlight(lcd_i2c_handle_t* lcd, bool on) {
         lcd->backlight_state = 0;
         ESP_LOGI(TAG, "LCD Backlight OFF");
     }
-    ESP_ERROR_CHECK(_lcd_send_byte_i2c(lcd, data_to_send));
+    _lcd_batch_push(lcd, data_to_send);
+    return _lcd_batch_flush(lcd);
 }
 
 esp_err_t lcd_i2c_clear(lcd_i2c_handle_t* lcd) {
@@ -165,6 +227,9 @@ esp_err_t lcd_i2c_clear(lcd_i2c_handle_t* lcd) {
     }
 
     ESP_LOGD(TAG, "Clearing LCD display");
+    memset(lcd->shadow, ' ', sizeof(lcd->shadow));
+    lcd->cursor_col = 0;
+    lcd->cursor_row = 0;
     return _lcd_send_cmd(lcd, LCD_CLEARDISPLAY);
 }
 
@@ -175,16 +240,13 @@ esp_err_t lcd_i2c_home(lcd_i2c_handle_t* lcd) {
     }
 
     ESP_LOGD(TAG, "Returning Cursor to Home");
+    lcd->cursor_col = 0;
+    lcd->cursor_row = 0;
 
     return _lcd_send_cmd(lcd, LCD_RETURNHOME);
 }
 
-esp_err_t lcd_i2c_set_cursor(lcd_i2c_handle_t* lcd, uint8_t col, uint8_t row) {
-    if (lcd == NULL) {
-        ESP_LOGE(TAG, "LCD handle is NULL in lcd_i2c_set_cursor");
-        return ESP_ERR_INVALID_ARG;
-    }
-
+static esp_err_t _lcd_set_cursor(lcd_i2c_handle_t* lcd, uint8_t col, uint8_t row) {
     if (col >= lcd->cols) {
         ESP_LOGW(TAG, "Column %d out of bounds (max %d). Clamping.", col, lcd->cols - 1);
         col = lcd->cols - 1; // Clamp to max column
@@ -208,19 +270,45 @@ esp_err_t lcd_i2c_set_cursor(lcd_i2c_handle_t* lcd, uint8_t col, uint8_t row) {
     address += col;
 
     ESP_LOGD(TAG, "Setting cursor to col %d, row %d (DDRAM address 0x%02x)", col, row, address);
+    lcd->cursor_col = col;
+    lcd->cursor_row = row;
 
     return _lcd_send_cmd(lcd, LCD_SETDDRAMADDR | address);
 }
 
+static esp_err_t _lcd_put_char(lcd_i2c_handle_t* lcd, char c) {
+    ESP_LOGD(TAG, "Printing character '%c' (0x%02x)", c, c);
+
+    // The controller auto-increments, past the last column the cursor is off-screen
+    if (lcd->cursor_col < lcd->cols) {
+        lcd->shadow[lcd->cursor_row][lcd->cursor_col] = c;
+    }
+    lcd->cursor_col++;
+
+    return _lcd_send_data(lcd, (uint8_t)c);
+}
+
+esp_err_t lcd_i2c_set_cursor(lcd_i2c_handle_t* lcd, uint8_t col, uint8_t row) {
+    if (lcd == NULL) {
+        ESP_LOGE(TAG, "LCD handle is NULL in lcd_i2c_set_cursor");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = _lcd_set_cursor(lcd, col, row);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return _lcd_batch_flush(lcd);
+}
+
 esp_err_t lcd_i2c_write_char(lcd_i2c_handle_t* lcd, char c) {
     if (lcd == NULL) {
         ESP_LOGE(TAG, "LCD handle is NULL in lcd_i2c_write_char");
         return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGD(TAG, "Printing character '%c' (0x%02x)", c, c);
-
-    return _lcd_send_data(lcd, (uint8_t)c);
+    _lcd_put_char(lcd, c);
+    return _lcd_batch_flush(lcd);
 }
 
 esp_err_t lcd_i2c_write_string(lcd_i2c_handle_t* lcd, const char* str, ...) {
@@ -254,35 +342,198 @@ esp_err_t lcd_i2c_write_string(lcd_i2c_handle_t* lcd, const char* str, ...) {
     int strIndex = 0;
 
     while (print_buffer[strIndex] != '\0' && strIndex < lcd->cols) {
-        ret = lcd_i2c_write_char(lcd, print_buffer[strIndex]);
+        _lcd_put_char(lcd, print_buffer[strIndex]);
+        strIndex++;
+    }
+
+    ret = _lcd_batch_flush(lcd);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to print formatted string \"%s\"", print_buffer);
+    }
+    return ret;
+}
 
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to print character '%c' (0x%02x) from formatted string at index %d",
-                     print_buffer[strIndex], print_buffer[strIndex], strIndex);
-            return ret;
+void lcd_frame_clear(lcd_frame_t* frame) {
+    memset(frame->text, ' ', sizeof(frame->text));
+    frame->glyph_count = 0;
+}
+
+char lcd_frame_glyph(lcd_frame_t* frame, const lcd_glyph_t* glyph) {
+    for (uint8_t i = 0; i < frame->glyph_count; i++) {
+        if (memcmp(&frame->glyphs[i], glyph, sizeof(lcd_glyph_t)) == 0) {
+            return LCD_GLYPH_BASE + i;
         }
-        strIndex++;
     }
 
-    return ESP_OK;
+    if (frame->glyph_count == LCD_CGRAM_SLOTS) {
+        return '?';
+    }
+
+    frame->glyphs[frame->glyph_count] = *glyph;
+    return LCD_GLYPH_BASE + frame->glyph_count++;
 }
 
-lcd_i2c_handle_t* lcd_i2c_init(void) {
-    ESP_LOGI(TAG, "Initializing LCD");
-    i2c_master_bus_handle_t i2c_bus = _lcd_i2c_master_init();
-    if (i2c_bus == NULL) {
-        ESP_LOGE(TAG, "FAILED TO INITIALIZE I2C BUS");
-        return NULL;
+void lcd_frame_printf(lcd_frame_t* frame, uint8_t col, uint8_t row, const char* fmt, ...) {
+    if (row >= LCD_ROWS || col >= LCD_COLS) {
+        return;
+    }
+
+    char print_buffer[LCD_COLS + 1];
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(print_buffer, sizeof(print_buffer), fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+    if (len > LCD_COLS - col) {
+        len = LCD_COLS - col;
+    }
+    memcpy(&frame->text[row][col], print_buffer, len);
+}
+
+static void _lcd_upload_glyph(lcd_i2c_handle_t* lcd, uint8_t slot, const lcd_glyph_t* glyph) {
+    _lcd_queue_byte(lcd, LCD_SETCGRAMADDR | (slot << 3), LCD_RS_COMMAND);
+    for (uint8_t i = 0; i < LCD_GLYPH_ROWS; i++) {
+        _lcd_queue_byte(lcd, glyph->rows[i], LCD_RS_DATA);
+    }
+
+    lcd->cgram[slot]   = *glyph;
+    lcd->cgram_loaded |= 1 << slot;
+
+    // The address counter now points into CGRAM, the next character needs a cursor move
+    lcd->cursor_col = lcd->cols;
+}
+
+// Points each frame glyph at a CGRAM slot. Slots that already hold the pattern are reused,
+// the rest are uploaded into free slots or the least recently used one the frame doesn't need.
+static void _lcd_map_glyphs(lcd_i2c_handle_t* lcd, const lcd_frame_t* frame, uint8_t* slots) {
+    uint8_t claimed = 0;
+
+    lcd->flush_count++;
+
+    for (uint8_t i = 0; i < frame->glyph_count; i++) {
+        slots[i] = LCD_CGRAM_SLOTS;
+        for (uint8_t slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+            uint8_t bit = 1 << slot;
+            if ((lcd->cgram_loaded & bit) && !(claimed & bit) &&
+                memcmp(&lcd->cgram[slot], &frame->glyphs[i], sizeof(lcd_glyph_t)) == 0) {
+                slots[i] = slot;
+                claimed |= bit;
+                break;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < frame->glyph_count; i++) {
+        if (slots[i] == LCD_CGRAM_SLOTS) {
+            uint8_t victim = LCD_CGRAM_SLOTS;
+            for (uint8_t slot = 0; slot < LCD_CGRAM_SLOTS; slot++) {
+                uint8_t bit = 1 << slot;
+                if (claimed & bit) {
+                    continue;
+                }
+                if (!(lcd->cgram_loaded & bit)) {
+                    victim = slot;
+                    break;
+                }
+                if (victim == LCD_CGRAM_SLOTS || lcd->cgram_used[slot] < lcd->cgram_used[victim]) {
+                    victim = slot;
+                }
+            }
+
+            _lcd_upload_glyph(lcd, victim, &frame->glyphs[i]);
+            slots[i] = victim;
+            claimed |= 1 << victim;
+        }
+        lcd->cgram_used[slots[i]] = lcd->flush_count;
+    }
+}
+
+// Rewrites only the changed runs of each row, all in one I2C write. Moving the cursor costs
+// one command, the same as one character, so runs one unchanged character apart are merged.
+esp_err_t lcd_i2c_flush(lcd_i2c_handle_t* lcd, const lcd_frame_t* frame) {
+    if (lcd == NULL) {
+        ESP_LOGE(TAG, "LCD handle is NULL in lcd_i2c_flush");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t slots[LCD_CGRAM_SLOTS];
+    _lcd_map_glyphs(lcd, frame, slots);
+
+    // Same frame with glyph codes rewritten to the CGRAM slots they ended up in
+    char text[LCD_ROWS][LCD_COLS];
+    memcpy(text, frame->text, sizeof(text));
+    for (uint8_t row = 0; row < lcd->rows; row++) {
+        for (uint8_t col = 0; col < lcd->cols; col++) {
+            uint8_t glyph = (uint8_t)text[row][col] - LCD_GLYPH_BASE;
+            if (glyph < frame->glyph_count) {
+                text[row][col] = LCD_GLYPH_BASE + slots[glyph];
+            }
+        }
+    }
+
+    for (uint8_t row = 0; row < lcd->rows; row++) {
+        uint8_t col = 0;
+
+        while (col < lcd->cols) {
+            if (text[row][col] == lcd->shadow[row][col]) {
+                col++;
+                continue;
+            }
+
+            uint8_t end = col + 1;
+            while (end < lcd->cols) {
+                if (text[row][end] != lcd->shadow[row][end]) {
+                    end++;
+                } else if (end + 1 < lcd->cols && text[row][end + 1] != lcd->shadow[row][end + 1]) {
+                    end += 2;
+                } else {
+                    break;
+                }
+            }
+
+            if (lcd->cursor_row != row || lcd->cursor_col != col) {
+                _lcd_set_cursor(lcd, col, row);
+            }
+            for (; col < end; col++) {
+                _lcd_put_char(lcd, text[row][col]);
+            }
+        }
     }
-    ESP_LOGI(TAG, "INITIALIZED I2C BUS");
 
-    lcd_i2c_handle_t* lcd_handle = _lcd_i2c_create(i2c_bus, LCD_I2C_ADDR, LCD_COLS, LCD_ROWS);
+    return _lcd_batch_flush(lcd);
+}
+
+lcd_i2c_handle_t* lcd_i2c_init(void) {
+    ESP_LOGI(TAG, "Initializing LCD");
+    lcd_i2c_handle_t* lcd_handle = _lcd_i2c_create(LCD_I2C_ADDR, LCD_COLS, LCD_ROWS);
     if (lcd_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create LCD handle!");
         return NULL;
     }
     ESP_LOGI(TAG, "LCD handle created");
+
+    // An absent or failing display still gets a handle, lcd_i2c_reset() retries later
     _lcd_init(lcd_handle);
 
     return lcd_handle;
+}
+
+esp_err_t lcd_i2c_reset(lcd_i2c_handle_t* lcd) {
+    if (lcd == NULL) {
+        ESP_LOGE(TAG, "LCD handle is NULL in lcd_i2c_reset");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The display may have been replugged or fallen back, pick the clock again first
+    esp_err_t ret = i2cbus_negotiate(lcd->dev);
+    if (ret != ESP_OK) {
+        lcd->ready = false;
+        return ret;
+    }
+
+    return _lcd_init(lcd);
 }
\ No newline at end of file
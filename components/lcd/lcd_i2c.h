@@ -2,21 +2,30 @@
 
 #pragma once
 
-#include "driver/i2c_master.h"
 #include "esp_err.h"
-
-#define I2C_MASTER_SDA_IO           GPIO_NUM_21
-#define I2C_MASTER_SCL_IO           GPIO_NUM_22
-#define I2C_MASTER_NUM              I2C_NUM_0
-
-#define I2C_MASTER_FREQ_HZ          100000
-#define I2C_MASTER_TX_BUF_DISABLE   0
-#define I2C_MASTER_RX_BUF_DISABLE   0
+#include "i2cbus.h"
 
 #define LCD_I2C_ADDR                0x27
+// The PCF8574 is specified for 100 kHz but backpacks commonly run at 400 kHz,
+// the bus falls back on its own if this one doesn't
+#define LCD_I2C_MAX_FREQ_HZ         400000
 #define LCD_COLS                    16
 #define LCD_ROWS                    2
 
+#define LCD_I2C_TIMEOUT_MS          1000
+#define LCD_BATCH_SIZE              256
+#define LCD_EXEC_TIME_US            50
+// Clear and home run for 1.52 ms, shorter than one tick, so they are waited out busy
+#define LCD_CLEAR_TIME_US           2000
+
+// Never drawn by callers, marks shadow cells whose glass contents are unknown
+#define LCD_SHADOW_INVALID          0x00
+
+// Codes 0x08-0x0F mirror CGRAM slots 0-7, leaving 0x00 free for the shadow
+#define LCD_CGRAM_SLOTS             8
+#define LCD_GLYPH_ROWS              8
+#define LCD_GLYPH_BASE              0x08
+
 #define PCF8574_RS                  0b00000001
 #define PCF8574_RW                  0b00000010
 #define PCF8574_EN                  0b00000100
@@ -57,17 +66,50 @@
 #define LCD_5x8DOTS                 0b00000000
 
 typedef struct {
-    i2c_master_dev_handle_t i2c_dev_handle;
+    uint8_t rows[LCD_GLYPH_ROWS];
+} lcd_glyph_t;
+
+// Glyph codes in text index the frame's own glyphs. lcd_i2c_flush() maps them onto
+// whichever CGRAM slots already hold the same pattern.
+typedef struct {
+    char text[LCD_ROWS][LCD_COLS];
+    lcd_glyph_t glyphs[LCD_CGRAM_SLOTS];
+    uint8_t glyph_count;
+} lcd_frame_t;
+
+// shadow mirrors what is on the glass, lcd_i2c_flush() sends only the characters of a
+// frame that differ from it. cgram does the same for the custom character slots.
+typedef struct {
+    i2cbus_device_t* dev;
     uint8_t cols;
     uint8_t rows;
     uint8_t backlight_state;
+    uint8_t cursor_col;
+    uint8_t cursor_row;
+    char shadow[LCD_ROWS][LCD_COLS];
+    lcd_glyph_t cgram[LCD_CGRAM_SLOTS];
+    uint8_t cgram_loaded;
+    uint32_t cgram_used[LCD_CGRAM_SLOTS];
+    uint32_t flush_count;
+    bool ready;
+    uint8_t exec_pad;
+    esp_err_t batch_err;
+    size_t batch_len;
+    uint8_t batch[LCD_BATCH_SIZE];
 } lcd_i2c_handle_t;
 
 lcd_i2c_handle_t* lcd_i2c_init(void);
+esp_err_t lcd_i2c_reset(lcd_i2c_handle_t* lcd);
 
-void lcd_i2c_backlight(lcd_i2c_handle_t* lcd, bool on);
+esp_err_t lcd_i2c_backlight(lcd_i2c_handle_t* lcd, bool on);
 esp_err_t lcd_i2c_home(lcd_i2c_handle_t* lcd);
 esp_err_t lcd_i2c_clear(lcd_i2c_handle_t* lcd);
 esp_err_t lcd_i2c_set_cursor(lcd_i2c_handle_t* lcd, uint8_t col, uint8_t row);
 esp_err_t lcd_i2c_write_char(lcd_i2c_handle_t* lcd, char c);
 esp_err_t lcd_i2c_write_string(lcd_i2c_handle_t* lcd, const char* str, ...);
+
+void lcd_frame_clear(lcd_frame_t* frame);
+void lcd_frame_printf(lcd_frame_t* frame, uint8_t col, uint8_t row, const char* fmt, ...);
+// Returns the character code to draw the glyph with, or '?' once all slots are taken
+char lcd_frame_glyph(lcd_frame_t* frame, const lcd_glyph_t* glyph);
+esp_err_t lcd_i2c_flush(lcd_i2c_handle_t* lcd, const lcd_frame_t* frame);
@@ -0,0 +1,116 @@
+// lcd_service.c
+
+#include "lcd_service.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+static const char* TAG = "LCD_SERVICE";
+
+// The service task is the only user of the LCD and its I2C device. Callers hand it whole
+// frames through a one-slot queue, so a slow or missing display never stalls them.
+static QueueHandle_t s_frame_queue = NULL;
+static lcd_service_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void _lcd_service_count(uint32_t* counter) {
+    portENTER_CRITICAL(&s_stats_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void _lcd_service_set_online(bool online) {
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.online = online;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void _lcd_service_task(void* pvParameters) {
+    (void)pvParameters;
+
+    lcd_i2c_handle_t* lcd = lcd_i2c_init();
+    if (lcd == NULL) {
+        ESP_LOGE(TAG, "LCD INITIALIZATION FAILED, DISPLAY DISABLED");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    lcd_frame_t frame;
+    lcd_frame_clear(&frame);
+    bool have_frame = false;
+    bool online     = lcd->ready;
+    _lcd_service_set_online(online);
+
+    while (true) {
+        // While the display is failing, wake up periodically to try bringing it back
+        TickType_t wait = online ? portMAX_DELAY : pdMS_TO_TICKS(LCD_SERVICE_RETRY_MS);
+        if (xQueueReceive(s_frame_queue, &frame, wait) == pdTRUE) {
+            have_frame = true;
+        }
+
+        if (!online) {
+            if (lcd_i2c_reset(lcd) != ESP_OK) {
+                continue;
+            }
+            _lcd_service_count(&s_stats.resets);
+            online = true;
+            _lcd_service_set_online(true);
+            ESP_LOGI(TAG, "LCD online");
+        }
+
+        if (!have_frame) {
+            continue;
+        }
+
+        if (lcd_i2c_flush(lcd, &frame) == ESP_OK) {
+            _lcd_service_count(&s_stats.rendered);
+        } else {
+            _lcd_service_count(&s_stats.errors);
+            lcd->ready = false;
+            online     = false;
+            _lcd_service_set_online(false);
+            ESP_LOGW(TAG, "LCD write failed, re-initializing in %d ms", LCD_SERVICE_RETRY_MS);
+        }
+    }
+}
+
+esp_err_t lcd_service_start(void) {
+    if (s_frame_queue != NULL) {
+        return ESP_OK;
+    }
+
+    s_frame_queue = xQueueCreate(1, sizeof(lcd_frame_t));
+    if (s_frame_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create LCD frame queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    BaseType_t result = xTaskCreate(_lcd_service_task, "lcd_service", LCD_SERVICE_STACK_SIZE, NULL, LCD_SERVICE_PRIORITY, NULL);
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create LCD service task");
+        vQueueDelete(s_frame_queue);
+        s_frame_queue = NULL;
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+void lcd_service_submit(const lcd_frame_t* frame) {
+    if (s_frame_queue == NULL) {
+        return;
+    }
+
+    if (uxQueueMessagesWaiting(s_frame_queue) > 0) {
+        _lcd_service_count(&s_stats.coalesced);
+    }
+    xQueueOverwrite(s_frame_queue, frame);
+    _lcd_service_count(&s_stats.submitted);
+}
+
+void lcd_service_get_stats(lcd_service_stats_t* stats) {
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
@@ -0,0 +1,26 @@
+// lcd_service.h
+
+#pragma once
+
+#include "lcd_i2c.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LCD_SERVICE_PRIORITY   4
+#define LCD_SERVICE_STACK_SIZE 3072
+#define LCD_SERVICE_RETRY_MS   2000
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t coalesced;
+    uint32_t rendered;
+    uint32_t errors;
+    uint32_t resets;
+    bool online;
+} lcd_service_stats_t;
+
+esp_err_t lcd_service_start(void);
+
+// Never blocks. A frame that hasn't been drawn yet is replaced by the newer one.
+void lcd_service_submit(const lcd_frame_t* frame);
+void lcd_service_get_stats(lcd_service_stats_t* stats);
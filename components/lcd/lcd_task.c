@@ -4,70 +4,165 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "dht11_task.hpp"
-#include "lcd_i2c.h"
+#include "lcd_service.h"
+#include <math.h>
 
 static const char* TAG = "LCD_TASK";
 static lcd_mode_t current_mode = LCD_MODE_TEMP;
 static TaskHandle_t lcd_display_task_handle = NULL;
+static uint32_t pending_cycles = 0;
+static portMUX_TYPE pending_cycles_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Bars grow from the bottom of the cell. The top level is the ROM's full block, so the
+// seven lower ones are the only glyphs this needs.
+static char _lcd_trend_bar(lcd_frame_t* frame, int level) {
+    if (level <= 0) {
+        return ' ';
+    }
+    if (level >= LCD_GLYPH_ROWS) {
+        return (char)0xFF;
+    }
+
+    lcd_glyph_t glyph = {0};
+    for (int row = LCD_GLYPH_ROWS - level; row < LCD_GLYPH_ROWS; row++) {
+        glyph.rows[row] = 0x1F;
+    }
+    return lcd_frame_glyph(frame, &glyph);
+}
+
+static void _lcd_draw_trend(lcd_frame_t* frame) {
+    dht11_reading_t samples[LCD_TREND_SAMPLES];
+    dht11_history_cursor_t cursor;
+    dht11_history_seek_last(LCD_TREND_SAMPLES, &cursor);
+    uint32_t count = dht11_history_read(&cursor, samples, LCD_TREND_SAMPLES);
+
+    if (count == 0) {
+        lcd_frame_printf(frame, 0, 0, "Trend: no data");
+        lcd_frame_printf(frame, 0, 1, "Next: Temp");
+        return;
+    }
+
+    float min = samples[0].temperature;
+    float max = samples[0].temperature;
+    for (uint32_t i = 1; i < count; i++) {
+        min = fminf(min, samples[i].temperature);
+        max = fmaxf(max, samples[i].temperature);
+    }
+
+    lcd_frame_printf(frame, 0, 0, "Trend %.0f-%.0f %cF", min, max, 223);
+
+    // Newest sample in the rightmost column, a flat history sits at half height
+    for (uint32_t i = 0; i < count; i++) {
+        int level = LCD_GLYPH_ROWS / 2;
+        if (max > min) {
+            level = 1 + (int)lroundf((samples[i].temperature - min) * (LCD_GLYPH_ROWS - 1) / (max - min));
+        }
+        frame->text[1][LCD_COLS - count + i] = _lcd_trend_bar(frame, level);
+    }
+}
+
+// Only the seconds counter changes between readings, every other mode sleeps until an event
+static TickType_t _lcd_refresh_delay(lcd_mode_t mode, const dht11_snapshot_t* reading) {
+    if (mode != LCD_MODE_LAST_READ || reading->monotonic_us == 0) {
+        return portMAX_DELAY;
+    }
+
+    uint64_t elapsed_us    = esp_timer_get_time() - reading->monotonic_us;
+    uint32_t until_next_us = 1000000 - elapsed_us % 1000000;
+    return pdMS_TO_TICKS(until_next_us / 1000) + 1;
+}
+
+static void _lcd_on_reading(const dht11_snapshot_t* snapshot, void* ctx) {
+    (void)snapshot;
+    (void)ctx;
+    if (lcd_display_task_handle != NULL) {
+        xTaskNotify(lcd_display_task_handle, LCD_NOTIFY_DATA, eSetBits);
+    }
+}
 
 void lcd_cycle_mode(void) {
+    portENTER_CRITICAL(&pending_cycles_lock);
+    pending_cycles++;
+    portEXIT_CRITICAL(&pending_cycles_lock);
+
     if (lcd_display_task_handle != NULL) {
-        xTaskNotify(lcd_display_task_handle, BUTTON_UL_VALUE, eSetValueWithoutOverwrite);
+        xTaskNotify(lcd_display_task_handle, LCD_NOTIFY_CYCLE, eSetBits);
     }
 }
 
+static uint32_t _lcd_take_cycles(void) {
+    portENTER_CRITICAL(&pending_cycles_lock);
+    uint32_t cycles = pending_cycles;
+    pending_cycles  = 0;
+    portEXIT_CRITICAL(&pending_cycles_lock);
+    return cycles;
+}
+
 void lcd_display_task(void *pvParameters) {
     (void)pvParameters;
     ESP_LOGI(TAG, "Starting LCD TASK");
 
     lcd_display_task_handle = xTaskGetCurrentTaskHandle();
 
-    lcd_i2c_handle_t* lcd_handle = lcd_i2c_init();
-    if (lcd_handle == NULL) {
-        ESP_LOGE(TAG, "LCD INITIALIZATION FAILED");
+    if (lcd_service_start() != ESP_OK) {
+        ESP_LOGE(TAG, "LCD SERVICE FAILED TO START");
+        vTaskDelete(NULL);
         return;
     }
 
-    ESP_LOGI(TAG, "LCD INITIALIZED");
-    
+    ESP_LOGI(TAG, "LCD SERVICE STARTED");
+
+    if (dht11_add_listener(_lcd_on_reading, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to subscribe to DHT11 readings");
+    }
+
+    // The first pass draws right away, later ones sleep until an event or the mode's deadline
+    TickType_t wait = 0;
+
     while(1) {
-        uint32_t ulNotifiedValue;
-        BaseType_t xResult = xTaskNotifyWait(0, UINT32_MAX, &ulNotifiedValue, pdMS_TO_TICKS(5000));
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, wait);
 
-        if (xResult == pdTRUE && ulNotifiedValue == BUTTON_UL_VALUE) {
+        if (events & LCD_NOTIFY_CYCLE) {
+            uint32_t cycles = _lcd_take_cycles();
             ESP_LOGI(TAG, "Button Pressed, Changing Mode");
-            current_mode = (current_mode + 1) % LCD_MODE_MAX;
+            current_mode = (current_mode + cycles) % LCD_MODE_MAX;
         }
 
-        vTaskDelay(pdMS_TO_TICKS(2));
-        lcd_i2c_clear(lcd_handle);
-        vTaskDelay(pdMS_TO_TICKS(2));
-        lcd_i2c_home(lcd_handle);
-        vTaskDelay(pdMS_TO_TICKS(2));
+        dht11_snapshot_t reading;
+        dht11_get_snapshot(&reading);
+
+        // Frames are drawn here and handed to the LCD service, which sends only what changed
+        lcd_frame_t frame;
+        lcd_frame_clear(&frame);
 
         switch (current_mode) {
             case LCD_MODE_TEMP:
-                float temperature = dht11_get_temperature();
-                lcd_i2c_write_string(lcd_handle, "Temp: %.2f %cF", temperature, 223);
-                lcd_i2c_set_cursor(lcd_handle, 0, 1);
-                lcd_i2c_write_string(lcd_handle, "Next: Hum");
+                lcd_frame_printf(&frame, 0, 0, "Temp: %.2f %cF", reading.temperature, 223);
+                lcd_frame_printf(&frame, 0, 1, "Next: Hum");
                 break;
             case LCD_MODE_HUM:
-                float humidity = dht11_get_humidity();
-                lcd_i2c_write_string(lcd_handle, "Hum: %.2f %%", humidity);
-                lcd_i2c_set_cursor(lcd_handle, 0, 1);
-                lcd_i2c_write_string(lcd_handle, "Next: Last Read");
+                lcd_frame_printf(&frame, 0, 0, "Hum: %.2f %%", reading.humidity);
+                lcd_frame_printf(&frame, 0, 1, "Next: Last Read");
                 break;
             case LCD_MODE_LAST_READ:
-                uint64_t last_read_us = dht11_get_last_read();
-                uint64_t current_time_us = esp_timer_get_time();
-                uint32_t seconds_since_last_read = (current_time_us - last_read_us) / 1000000;
-                lcd_i2c_write_string(lcd_handle, "LR: %lu secs ago", seconds_since_last_read);
-                lcd_i2c_set_cursor(lcd_handle, 0, 1);
-                lcd_i2c_write_string(lcd_handle, "Next: Temp");
+                if (reading.monotonic_us == 0) {
+                    lcd_frame_printf(&frame, 0, 0, "LR: no reading");
+                } else {
+                    uint64_t current_time_us = esp_timer_get_time();
+                    uint32_t seconds_since_last_read = (current_time_us - reading.monotonic_us) / 1000000;
+                    lcd_frame_printf(&frame, 0, 0, "LR: %lu secs ago", seconds_since_last_read);
+                }
+                lcd_frame_printf(&frame, 0, 1, "Next: Trend");
+                break;
+            case LCD_MODE_TREND:
+                _lcd_draw_trend(&frame);
                 break;
             default:
                 break;
         }
+
+        lcd_service_submit(&frame);
+        wait = _lcd_refresh_delay(current_mode, &reading);
     }
-}
\ No newline at end of file
+}
@@ -2,12 +2,17 @@
 
 #pragma once
 #define LCD_TASK_H
-#define BUTTON_UL_VALUE 14
+
+// Task notification bits, events arriving together are all seen by the next wakeup
+#define LCD_NOTIFY_DATA (1 << 0)
+#define LCD_NOTIFY_CYCLE (1 << 1)
+#define LCD_TREND_SAMPLES 16
 
 typedef enum {
     LCD_MODE_TEMP,
     LCD_MODE_HUM,
     LCD_MODE_LAST_READ,
+    LCD_MODE_TREND,
     LCD_MODE_MAX
 } lcd_mode_t;
 
@@ -0,0 +1,58 @@
+// audio_adpcm.c
+
+#include "audio_adpcm.h"
+
+static const int8_t index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+static const int16_t step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+void audio_adpcm_init(audio_adpcm_state_t* state) {
+    state->predictor  = 0;
+    state->step_index = 0;
+}
+
+int16_t audio_adpcm_decode(audio_adpcm_state_t* state, uint8_t nibble) {
+    int32_t step = step_table[state->step_index];
+    int32_t diff = step >> 3;
+
+    if (nibble & 4) {
+        diff += step;
+    }
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+
+    int32_t predictor = state->predictor + ((nibble & 8) ? -diff : diff);
+    if (predictor > INT16_MAX) {
+        predictor = INT16_MAX;
+    } else if (predictor < INT16_MIN) {
+        predictor = INT16_MIN;
+    }
+
+    int32_t index = state->step_index + index_table[nibble & 0x0F];
+    if (index < 0) {
+        index = 0;
+    } else if (index > 88) {
+        index = 88;
+    }
+
+    state->predictor  = (int16_t)predictor;
+    state->step_index = (uint8_t)index;
+    return state->predictor;
+}
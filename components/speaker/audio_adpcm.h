@@ -0,0 +1,15 @@
+// audio_adpcm.h
+
+#pragma once
+
+#include <stdint.h>
+
+// IMA-ADPCM decoder state. Clips are one continuous stream starting from a zero
+// predictor, low nibble first, matching audio_data_generator.py --adpcm.
+typedef struct {
+    int16_t predictor;
+    uint8_t step_index;
+} audio_adpcm_state_t;
+
+void audio_adpcm_init(audio_adpcm_state_t* state);
+int16_t audio_adpcm_decode(audio_adpcm_state_t* state, uint8_t nibble);
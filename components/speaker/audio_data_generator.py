@@ -1,3 +1,6 @@
+import argparse
+import math
+import random
 import sys
 import os
 import struct
@@ -70,28 +73,114 @@ def parse_wav(wav_file_path):
             else:
                 f.seek(chunk_size, 1)
 
-        processed_data = []
+        # Everything is kept as signed 16-bit until the output format is chosen
+        samples = []
         if bits_per_sample == 8:
-            if num_channels == 1:
-                processed_data = list(raw_audio_data)
-            else:
-                for i in range(0, len(raw_audio_data), num_channels):
-                    processed_data.append(raw_audio_data[i])
+            for i in range(0, len(raw_audio_data), num_channels):
+                samples.append((raw_audio_data[i] - 128) << 8)
         elif bits_per_sample == 16:
             bytes_per_sample = bits_per_sample // 8
             for i in range(0, len(raw_audio_data), bytes_per_sample * num_channels):
-                sample_16bit = struct.unpack('<h', raw_audio_data[i : i + bytes_per_sample])[0]
-                sample_8bit = int((sample_16bit + 32768) / 256.0)
-                processed_data.append(max(0, min(255, sample_8bit)))
+                samples.append(struct.unpack('<h', raw_audio_data[i : i + bytes_per_sample])[0])
     
-    return processed_data, sample_rate
+    return samples, sample_rate
+
+IMA_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+IMA_STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+]
+
+RESAMPLE_TAPS = 32
+RESAMPLE_CUTOFF = 0.9
+
+# Windowed-sinc interpolation. The cutoff follows the lower of the two rates, so going
+# down filters out what the new rate can't hold instead of folding it back as aliasing.
+def resample(samples, in_rate, out_rate):
+    if in_rate == out_rate or not samples:
+        return list(samples)
+
+    ratio = in_rate / out_rate
+    cutoff = RESAMPLE_CUTOFF * min(1.0, out_rate / in_rate)
+    half = int(math.ceil(RESAMPLE_TAPS / 2 / min(1.0, out_rate / in_rate)))
+    out_len = int(len(samples) * out_rate // in_rate)
+    out = []
+
+    for n in range(out_len):
+        t = n * ratio
+        center = int(t)
+        acc = 0.0
+        for k in range(center - half + 1, center + half + 1):
+            if k < 0 or k >= len(samples):
+                continue
+            x = t - k
+            # Blackman window over the kernel span
+            w = 0.42 + 0.5 * math.cos(math.pi * x / half) + 0.08 * math.cos(2 * math.pi * x / half)
+            h = cutoff if x == 0 else math.sin(math.pi * cutoff * x) / (math.pi * x)
+            acc += samples[k] * h * w
+        out.append(max(-32768, min(32767, int(round(acc)))))
+    return out
+
+# TPDF dither of one 8-bit step keeps the quantisation error uncorrelated with the signal.
+# Seeded so the same WAV always builds the same image.
+def to_pcm_u8(samples):
+    rng = random.Random(0)
+    out = []
+    for s in samples:
+        dither = (rng.random() - rng.random()) * 256
+        out.append(max(0, min(255, int(round((s + dither) / 256.0)) + 128)))
+    return out
+
+# One continuous stream from a zero predictor, low nibble first. The encoder tracks the
+# decoder's reconstruction so audio_adpcm.c reproduces it exactly. Pass a list as
+# reconstruction to get the decoded samples back, the host tests check against them.
+def to_ima_adpcm(samples, reconstruction=None):
+    predictor = 0
+    index = 0
+    nibbles = []
+
+    for sample in samples:
+        step = IMA_STEP_TABLE[index]
+        diff = sample - predictor
+        code = 0
+        if diff < 0:
+            code = 8
+            diff = -diff
 
-def generate_c_file(output_file_path, audio_data, sample_rate):
+        vpdiff = step >> 3
+        if diff >= step:
+            code |= 4
+            diff -= step
+            vpdiff += step
+        if diff >= step >> 1:
+            code |= 2
+            diff -= step >> 1
+            vpdiff += step >> 1
+        if diff >= step >> 2:
+            code |= 1
+            vpdiff += step >> 2
+
+        predictor = predictor - vpdiff if code & 8 else predictor + vpdiff
+        predictor = max(-32768, min(32767, predictor))
+        index = max(0, min(88, index + IMA_INDEX_TABLE[code]))
+        nibbles.append(code)
+        if reconstruction is not None:
+            reconstruction.append(predictor)
+
+    if len(nibbles) % 2:
+        nibbles.append(0)
+    return [nibbles[i] | (nibbles[i + 1] << 4) for i in range(0, len(nibbles), 2)]
+
+def generate_c_file(output_file_path, header_name, name, audio_data, num_samples, audio_format, priority, sample_rate):
     with open(output_file_path, "w") as f:
-        f.write("// audio_data.h\n\n")
-        f.write("#pragma once\n")
-        f.write(f"#define SAMPLE_RATE {sample_rate}\n\n")
-        f.write("uint8_t audio_fx[] = {\n\t")
+        f.write(f"// {os.path.basename(output_file_path)}\n\n")
+        f.write(f'#include "{header_name}"\n\n')
+        f.write(f"static const uint8_t {name}_data[] = {{\n\t")
 
         for i, byte_val in enumerate(audio_data):
             f.write(f"0x{byte_val:02X}")
@@ -100,26 +189,56 @@ def generate_c_file(output_file_path, audio_data, sample_rate):
             if (i + 1) % 16 == 0 and (i + 1) < len(audio_data):
                 f.write("\n\t")
         f.write("\n};\n\n")
-        f.write(f"size_t audio_fx_len = {len(audio_data)};\n\n")
+
+        f.write(f"const audio_clip_t {name}_clip = {{\n")
+        f.write(f"    .format         = {audio_format},\n")
+        f.write(f"    .data           = {name}_data,\n")
+        f.write(f"    .samples        = {num_samples},\n")
+        f.write(f"    .sample_rate_hz = {sample_rate},\n")
+        f.write(f"    .gain           = AUDIO_GAIN_UNITY,\n")
+        f.write(f"    .priority       = {priority},\n")
+        f.write("};\n")
+
+def generate_h_file(output_file_path, name, sample_rate):
+    with open(output_file_path, "w") as f:
+        f.write(f"// {os.path.basename(output_file_path)}\n\n")
+        f.write("#pragma once\n\n")
+        f.write('#include "audio_mixer.h"\n\n')
+        f.write(f"#define {name.upper()}_SAMPLE_RATE {sample_rate}\n\n")
+        f.write(f"extern const audio_clip_t {name}_clip;\n")
 
 if __name__ == "__main__":
-    if len(sys.argv) != 3:
-        print("Usage: python audio_data_generator.py <input_wav_file> <output_c_header_file>")
-        sys.exit(1)
-    
-    input_wav_path = sys.argv[1]
-    output_header_path = sys.argv[2]
+    parser = argparse.ArgumentParser(description="Converts a WAV file into a const audio clip kept in flash")
+    parser.add_argument("input_wav")
+    parser.add_argument("output_c")
+    parser.add_argument("output_h")
+    parser.add_argument("--name", default="audio_fx", help="C identifier prefix of the clip")
+    parser.add_argument("--adpcm", action="store_true", help="store the clip as 4-bit IMA-ADPCM instead of 8-bit PCM")
+    parser.add_argument("--priority", type=int, default=1, help="playback priority of the clip")
+    parser.add_argument("--rate", type=int, default=0, help="resample to this rate in Hz, default keeps the WAV's rate")
+    args = parser.parse_args()
 
-    if not os.path.exists(input_wav_path):
-        print(f"Error: Input WAV file not found at '{input_wav_path}'")
+    if not os.path.exists(args.input_wav):
+        print(f"Error: Input WAV file not found at '{args.input_wav}'")
         sys.exit(1)
 
     try:
-        audio_data, sample_rate = parse_wav(input_wav_path)
-        generate_c_file(output_header_path, audio_data, sample_rate)
-        print(f"Successfully generated {output_header_path} from {input_wav_path}")
+        print(f"Processing '{args.input_wav}'...")
+        samples, sample_rate = parse_wav(args.input_wav)
+        if args.rate > 0 and args.rate != sample_rate:
+            print(f"Resampling {sample_rate} Hz to {args.rate} Hz")
+            samples = resample(samples, sample_rate, args.rate)
+            sample_rate = args.rate
+        if args.adpcm:
+            audio_data = to_ima_adpcm(samples)
+            audio_format = "AUDIO_CLIP_IMA_ADPCM"
+        else:
+            audio_data = to_pcm_u8(samples)
+            audio_format = "AUDIO_CLIP_PCM_U8"
+
+        generate_c_file(args.output_c, os.path.basename(args.output_h), args.name, audio_data, len(samples), audio_format, args.priority, sample_rate)
+        generate_h_file(args.output_h, args.name, sample_rate)
+        print(f"Successfully generated {args.output_c} and {args.output_h} from {args.input_wav} ({len(audio_data)} bytes)")
     except Exception as e:
         print(f"Error processing WAV file: {e}")
         sys.exit(1)
-
-    print(f"Processing '{input_wav_path}'...")
@@ -0,0 +1,114 @@
+// audio_mixer.c
+
+#include "audio_mixer.h"
+#include <string.h>
+
+void audio_mixer_init(audio_mixer_t* mixer, uint32_t sample_rate_hz) {
+    memset(mixer, 0, sizeof(*mixer));
+    mixer->sample_rate_hz = sample_rate_hz;
+    mixer->volume         = AUDIO_GAIN_UNITY;
+}
+
+void audio_mixer_set_volume(audio_mixer_t* mixer, uint16_t volume) {
+    mixer->volume = volume;
+}
+
+void audio_mixer_stop(audio_mixer_t* mixer) {
+    for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        mixer->voices[i].clip = NULL;
+    }
+}
+
+int audio_mixer_pick_voice(const audio_mixer_t* mixer, uint8_t priority) {
+    int lowest = -1;
+
+    for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        const audio_clip_t* clip = mixer->voices[i].clip;
+        if (clip == NULL) {
+            return i;
+        }
+        if (clip->priority < priority && (lowest < 0 || clip->priority < mixer->voices[lowest].clip->priority)) {
+            lowest = i;
+        }
+    }
+    return lowest;
+}
+
+void audio_mixer_start(audio_mixer_t* mixer, int voice, const audio_clip_t* clip) {
+    audio_voice_t* v = &mixer->voices[voice];
+
+    v->clip       = clip->samples > 0 ? clip : NULL;
+    v->pos        = 0;
+    v->phase      = 0;
+    v->phase_step = 0;
+    audio_adpcm_init(&v->adpcm);
+    if (clip->format == AUDIO_CLIP_TONE && mixer->sample_rate_hz > 0) {
+        v->phase_step = (uint32_t)(((uint64_t)clip->tone_hz << 32) / mixer->sample_rate_hz);
+    }
+}
+
+bool audio_mixer_active(const audio_mixer_t* mixer) {
+    for (int i = 0; i < AUDIO_MIXER_VOICES; i++) {
+        if (mixer->voices[i].clip != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Output steps are Q24 once the Q8 samples went through the Q8 gain and volume
+#define AUDIO_MIXER_SHIFT 24
+#define AUDIO_MIXER_HALF_STEP (1 << (AUDIO_MIXER_SHIFT - 1))
+
+// Signed Q8 sample around zero, before gain. ADPCM decodes to 16 bits, which is already
+// an 8-bit sample with 8 bits of fraction.
+static int32_t _audio_voice_next(audio_voice_t* v) {
+    const audio_clip_t* clip = v->clip;
+    int32_t sample;
+
+    if (clip->format == AUDIO_CLIP_TONE) {
+        sample    = (v->phase & 0x80000000u) ? -AUDIO_TONE_AMPLITUDE * 256 : AUDIO_TONE_AMPLITUDE * 256;
+        v->phase += v->phase_step;
+    } else if (clip->format == AUDIO_CLIP_IMA_ADPCM) {
+        uint8_t byte   = clip->data[v->pos >> 1];
+        uint8_t nibble = (v->pos & 1) ? byte >> 4 : byte & 0x0F;
+        sample         = audio_adpcm_decode(&v->adpcm, nibble);
+    } else {
+        sample = ((int32_t)clip->data[v->pos] - AUDIO_SAMPLE_MIDPOINT) * 256;
+    }
+
+    if (++v->pos >= clip->samples) {
+        v->clip = NULL;
+    }
+    return sample;
+}
+
+// Truncating to 8 bits alone adds an error that follows the signal, which is audible as
+// distortion on quiet ADPCM clips and fades. Carrying the rounding error into the next
+// sample turns it into noise pushed up in frequency, and costs no random numbers. A sum
+// that is already a whole step, like silence or a unity gain PCM clip, stays exact.
+void audio_mixer_render(audio_mixer_t* mixer, uint8_t* out, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        int64_t acc = 0;
+
+        for (int j = 0; j < AUDIO_MIXER_VOICES; j++) {
+            audio_voice_t* v = &mixer->voices[j];
+            if (v->clip != NULL) {
+                int32_t gain = v->clip->gain;
+                acc += (int64_t)_audio_voice_next(v) * gain;
+            }
+        }
+
+        // The error is taken before saturating, so a clipped peak doesn't wind it up
+        int64_t level = acc * mixer->volume + mixer->error;
+        int32_t step  = (int32_t)((level + AUDIO_MIXER_HALF_STEP) >> AUDIO_MIXER_SHIFT);
+        mixer->error  = (int32_t)(level - ((int64_t)step << AUDIO_MIXER_SHIFT));
+
+        if (step > 127) {
+            step = 127;
+        } else if (step < -128) {
+            step = -128;
+        }
+        out[i] = (uint8_t)(step + AUDIO_SAMPLE_MIDPOINT);
+    }
+}
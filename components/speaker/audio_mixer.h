@@ -0,0 +1,66 @@
+// audio_mixer.h
+
+#pragma once
+
+#include "audio_adpcm.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AUDIO_MIXER_VOICES 2
+
+// Gains are Q8, 256 plays a clip at its recorded level
+#define AUDIO_GAIN_UNITY 256
+#define AUDIO_TONE_AMPLITUDE 48
+#define AUDIO_SAMPLE_MIDPOINT 0x80
+
+typedef enum {
+    AUDIO_CLIP_PCM_U8,
+    AUDIO_CLIP_IMA_ADPCM,
+    AUDIO_CLIP_TONE,
+} audio_clip_format_t;
+
+// PCM and ADPCM clips play data (two samples per byte for ADPCM, decoded while mixing),
+// tone clips synthesise a square wave at tone_hz. All of them last samples. Recorded clips
+// carry the rate they were built for, tones leave it 0 and follow the mixer.
+typedef struct {
+    audio_clip_format_t format;
+    const uint8_t* data;
+    size_t samples;
+    uint32_t sample_rate_hz;
+    uint16_t tone_hz;
+    uint16_t gain;
+    uint8_t priority;
+} audio_clip_t;
+
+typedef struct {
+    const audio_clip_t* clip;
+    size_t pos;
+    uint32_t phase;
+    uint32_t phase_step;
+    audio_adpcm_state_t adpcm;
+} audio_voice_t;
+
+// volume is a Q8 master gain applied after the voices are summed. error is what rounding
+// the last sample to 8 bits left out, carried into the next one.
+typedef struct {
+    audio_voice_t voices[AUDIO_MIXER_VOICES];
+    uint32_t sample_rate_hz;
+    uint16_t volume;
+    int32_t error;
+} audio_mixer_t;
+
+void audio_mixer_init(audio_mixer_t* mixer, uint32_t sample_rate_hz);
+void audio_mixer_set_volume(audio_mixer_t* mixer, uint16_t volume);
+void audio_mixer_stop(audio_mixer_t* mixer);
+
+// Returns a free voice, else the lowest priority voice playing below priority, else -1
+int audio_mixer_pick_voice(const audio_mixer_t* mixer, uint8_t priority);
+void audio_mixer_start(audio_mixer_t* mixer, int voice, const audio_clip_t* clip);
+bool audio_mixer_active(const audio_mixer_t* mixer);
+
+// Sums every active voice into out as unsigned 8-bit samples, saturating instead of
+// wrapping, and frees the voices whose clip ended. Silence when nothing plays. The sum
+// keeps every bit of the gains and of decoded ADPCM until the one reduction to 8 bits,
+// which feeds its rounding error forward so the average level survives it.
+void audio_mixer_render(audio_mixer_t* mixer, uint8_t* out, size_t samples);
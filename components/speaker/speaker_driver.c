@@ -5,63 +5,432 @@
 #include "driver/dac_continuous.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
-#include <stdio.h>
+#include <stdbool.h>
 #include <string.h>
 
-#define I2S_PORT I2S_NUM_0
+// The DAC runs at the rate the embedded clip was resampled to at build time
+#define SPEAKER_SAMPLE_RATE_HZ AUDIO_FX_SAMPLE_RATE
 
 static const char* TAG = "AUDIO_DRIVER";
-static TaskHandle_t speaker_task_handle = NULL;
 dac_continuous_handle_t dac_handle;
 
-static void speaker_driver_init(void) {
+typedef enum {
+    SPEAKER_EVENT_DMA_DONE,
+    SPEAKER_EVENT_PLAY,
+    SPEAKER_EVENT_STOP,
+    SPEAKER_EVENT_VOLUME,
+} speaker_event_type_t;
+
+// DMA_DONE hands back a buffer the hardware finished with, time_us is when. Commands
+// carry the time they were made.
+typedef struct {
+    speaker_event_type_t type;
+    speaker_clip_id_t clip;
+    uint8_t volume;
+    uint8_t* buf;
+    size_t size;
+    int64_t time_us;
+} speaker_event_t;
+
+// A play request waiting for a voice. seq keeps requests of equal priority in order.
+typedef struct {
+    speaker_clip_id_t clip;
+    uint32_t seq;
+    int64_t requested_us;
+} speaker_request_t;
+
+static QueueHandle_t events = NULL;
+static audio_mixer_t mixer;
+static uint8_t mix_buf[SPEAKER_MIX_SAMPLES];
+
+static const audio_clip_t error_clip = {
+    .format   = AUDIO_CLIP_TONE,
+    .samples  = SPEAKER_SAMPLE_RATE_HZ / 4,
+    .tone_hz  = 330,
+    .gain     = AUDIO_GAIN_UNITY,
+    .priority = 2,
+};
+
+static const audio_clip_t key_click_clip = {
+    .format   = AUDIO_CLIP_TONE,
+    .samples  = SPEAKER_SAMPLE_RATE_HZ / 64,
+    .tone_hz  = 2000,
+    .gain     = AUDIO_GAIN_UNITY / 2,
+    .priority = 0,
+};
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static speaker_stats_t stats  = {.volume = SPEAKER_VOLUME_MAX};
+static const audio_clip_t* clips[SPEAKER_CLIP_MAX] = {
+    [SPEAKER_CLIP_READ_COMPLETE] = &audio_fx_clip,
+    [SPEAKER_CLIP_ERROR]         = &error_clip,
+    [SPEAKER_CLIP_KEY_CLICK]     = &key_click_clip,
+};
+
+// Owned by the speaker task
+static speaker_request_t pending[SPEAKER_QUEUE_LEN];
+static size_t pending_count = 0;
+static uint32_t next_seq    = 0;
+static bool fading_in       = false;
+static bool fading_out      = false;
+static int drain_blocks     = 0;
+static int64_t requested_us = 0;
+
+static bool IRAM_ATTR _speaker_on_convert_done(dac_continuous_handle_t handle, const dac_event_data_t* event, void* user_data) {
+    speaker_event_t done = {
+        .type    = SPEAKER_EVENT_DMA_DONE,
+        .buf     = event->buf,
+        .size    = event->buf_size,
+        .time_us = esp_timer_get_time(),
+    };
+
+    // With the task behind, the DMA replays whatever the buffer last held
+    BaseType_t higher_priority_task = pdFALSE;
+    if (xQueueSendFromISR(events, &done, &higher_priority_task) != pdTRUE) {
+        portENTER_CRITICAL_ISR(&stats_lock);
+        stats.underruns++;
+        portEXIT_CRITICAL_ISR(&stats_lock);
+    }
+    return higher_priority_task == pdTRUE;
+}
+
+// The channel is allocated once, so waking only re-powers the DAC and restarts the DMA
+// instead of a fresh descriptor and APLL setup
+static esp_err_t speaker_driver_init(void) {
+    audio_mixer_init(&mixer, audio_fx_clip.sample_rate_hz);
+
     dac_continuous_config_t dac_cfg = {
         .chan_mask = DAC_CHANNEL_MASK_CH0,
-        .desc_num  = 4,
-        .buf_size  = 1024,
-        .freq_hz   = 16000,
+        .desc_num  = SPEAKER_DMA_DESC_NUM,
+        .buf_size  = SPEAKER_DMA_BUF_SIZE,
+        .freq_hz   = audio_fx_clip.sample_rate_hz,
         .offset    = 0,
         .clk_src   = DAC_DIGI_CLK_SRC_APLL,
     };
 
-    ESP_ERROR_CHECK(dac_continuous_new_channels(&dac_cfg, &dac_handle));
-    ESP_ERROR_CHECK(dac_continuous_enable(dac_handle));
+    esp_err_t ret = dac_continuous_new_channels(&dac_cfg, &dac_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "FAILED TO CREATE DAC CHANNEL: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    dac_event_callbacks_t callbacks = {
+        .on_convert_done = _speaker_on_convert_done,
+    };
+    ret = dac_continuous_register_event_callback(dac_handle, &callbacks, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "FAILED TO REGISTER DAC CALLBACK: %s", esp_err_to_name(ret));
+        dac_continuous_del_channels(dac_handle);
+        dac_handle = NULL;
+        return ret;
+    }
+    return ESP_OK;
 }
 
-static void speaker_driver_play(void) {
-    size_t written = 0;
-    ESP_ERROR_CHECK(dac_continuous_write(dac_handle, audio_fx, audio_fx_len, &written, portMAX_DELAY));
+static esp_err_t _speaker_power_up(void) {
+    esp_err_t ret = dac_continuous_enable(dac_handle);
+    if (ret == ESP_OK) {
+        ret = dac_continuous_start_async_writing(dac_handle);
+        if (ret != ESP_OK) {
+            dac_continuous_disable(dac_handle);
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to power up DAC: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    fading_in = true;
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.powered = true;
+    stats.power_ups++;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
 }
 
-static void speaker_driver_deinit(void) {
+static void _speaker_power_down(void) {
+    dac_continuous_stop_async_writing(dac_handle);
     dac_continuous_disable(dac_handle);
-    dac_continuous_del_channels(dac_handle);
+    fading_out = false;
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.powered = false;
+    portEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGD(TAG, "DAC powered down");
 }
 
-void speaker_play_sound(void) {
-    if (speaker_task_handle != NULL) {
-        xTaskNotify(speaker_task_handle, SPEAKER_UL_VALUE, eSetValueWithoutOverwrite);
+static bool _speaker_send(const speaker_event_t* event) {
+    if (events == NULL || uxQueueSpacesAvailable(events) <= SPEAKER_DMA_DESC_NUM) {
+        return false;
+    }
+    return xQueueSend(events, event, 0) == pdTRUE;
+}
+
+// Index of the request to play next, or of the one to give up when the queue is full
+static size_t _speaker_find_pending(bool highest) {
+    size_t found = 0;
+
+    for (size_t i = 1; i < pending_count; i++) {
+        uint8_t p = clips[pending[i].clip]->priority;
+        uint8_t f = clips[pending[found].clip]->priority;
+        if (highest ? (p > f || (p == f && pending[i].seq < pending[found].seq))
+                    : (p < f || (p == f && pending[i].seq > pending[found].seq))) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+static void _speaker_queue_request(const speaker_event_t* event) {
+    speaker_request_t request = {
+        .clip         = event->clip,
+        .seq          = next_seq++,
+        .requested_us = event->time_us,
+    };
+
+    for (size_t i = 0; i < pending_count; i++) {
+        if (pending[i].clip == request.clip) {
+            portENTER_CRITICAL(&stats_lock);
+            stats.coalesced++;
+            portEXIT_CRITICAL(&stats_lock);
+            return;
+        }
+    }
+
+    if (pending_count < SPEAKER_QUEUE_LEN) {
+        pending[pending_count++] = request;
+        return;
+    }
+
+    size_t lowest = _speaker_find_pending(false);
+    if (clips[request.clip]->priority > clips[pending[lowest].clip]->priority) {
+        pending[lowest] = request;
     }
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.dropped++;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// Hands queued requests to the mixer while a voice is free or can be taken from a lower
+// priority clip. Returns the request time of the first one started, 0 if none.
+static int64_t _speaker_start_pending(void) {
+    int64_t first_requested_us = 0;
+
+    while (pending_count > 0) {
+        size_t next              = _speaker_find_pending(true);
+        const audio_clip_t* clip = clips[pending[next].clip];
+
+        int voice = audio_mixer_pick_voice(&mixer, clip->priority);
+        if (voice < 0) {
+            break;
+        }
+
+        portENTER_CRITICAL(&stats_lock);
+        if (mixer.voices[voice].clip != NULL) {
+            stats.preempted++;
+        }
+        stats.played++;
+        portEXIT_CRITICAL(&stats_lock);
+
+        audio_mixer_start(&mixer, voice, clip);
+        if (first_requested_us == 0) {
+            first_requested_us = pending[next].requested_us;
+        }
+        pending[next] = pending[--pending_count];
+    }
+
+    return first_requested_us;
 }
 
+// Ramps the first samples of the block up from zero, or down to zero and holds it there
+static void _speaker_fade(uint8_t* buf, size_t len, bool in) {
+    for (size_t i = 0; i < len; i++) {
+        uint32_t level = i < SPEAKER_FADE_SAMPLES ? i : SPEAKER_FADE_SAMPLES;
+        if (!in) {
+            level = SPEAKER_FADE_SAMPLES - level;
+        }
+        buf[i] = (uint8_t)(buf[i] * level / SPEAKER_FADE_SAMPLES);
+    }
+}
+
+static void _speaker_refill(const speaker_event_t* done) {
+    // The buffer filled last time starts playing as this one finishes
+    if (requested_us != 0) {
+        uint32_t latency = (uint32_t)(done->time_us - requested_us);
+        requested_us     = 0;
+
+        portENTER_CRITICAL(&stats_lock);
+        stats.last_latency_us = latency;
+        if (latency > stats.max_latency_us) {
+            stats.max_latency_us = latency;
+        }
+        portEXIT_CRITICAL(&stats_lock);
+
+        ESP_LOGD(TAG, "First sample %lu us after request", (unsigned long)latency);
+    }
+
+    // Once the fade-out block and everything queued behind it has played, the output
+    // sits at zero and the DAC can go
+    if (fading_out) {
+        if (++drain_blocks >= SPEAKER_DMA_DESC_NUM) {
+            _speaker_power_down();
+            return;
+        }
+        memset(mix_buf, 0, sizeof(mix_buf));
+    } else {
+        requested_us = _speaker_start_pending();
+
+        bool idle = !audio_mixer_active(&mixer);
+        audio_mixer_render(&mixer, mix_buf, SPEAKER_MIX_SAMPLES);
+
+        if (fading_in) {
+            _speaker_fade(mix_buf, SPEAKER_MIX_SAMPLES, true);
+            fading_in = false;
+        } else if (idle) {
+            _speaker_fade(mix_buf, SPEAKER_MIX_SAMPLES, false);
+            fading_out   = true;
+            drain_blocks = 0;
+        }
+    }
+
+    size_t loaded = 0;
+    dac_continuous_write_asynchronously(dac_handle, done->buf, done->size, mix_buf, SPEAKER_MIX_SAMPLES, &loaded);
+}
+
+esp_err_t speaker_register_clip(speaker_clip_id_t id, const audio_clip_t* clip) {
+    if (id >= SPEAKER_CLIP_MAX || clip == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (clip->sample_rate_hz != 0 && clip->sample_rate_hz != audio_fx_clip.sample_rate_hz) {
+        ESP_LOGE(TAG, "Clip %d is %lu Hz, the speaker runs at %lu Hz", id,
+                 (unsigned long)clip->sample_rate_hz, (unsigned long)audio_fx_clip.sample_rate_hz);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    clips[id] = clip;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+void speaker_play_clip(speaker_clip_id_t id) {
+    if (id >= SPEAKER_CLIP_MAX) {
+        return;
+    }
+
+    speaker_event_t event = {
+        .type    = SPEAKER_EVENT_PLAY,
+        .clip    = id,
+        .time_us = esp_timer_get_time(),
+    };
+    bool sent = _speaker_send(&event);
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.requested++;
+    if (!sent) {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void speaker_play_sound(void) {
+    speaker_play_clip(SPEAKER_CLIP_READ_COMPLETE);
+}
+
+void speaker_stop(void) {
+    speaker_event_t event = {
+        .type    = SPEAKER_EVENT_STOP,
+        .time_us = esp_timer_get_time(),
+    };
+    _speaker_send(&event);
+}
+
+void speaker_set_volume(uint8_t percent) {
+    speaker_event_t event = {
+        .type    = SPEAKER_EVENT_VOLUME,
+        .volume  = percent > SPEAKER_VOLUME_MAX ? SPEAKER_VOLUME_MAX : percent,
+        .time_us = esp_timer_get_time(),
+    };
+    _speaker_send(&event);
+}
+
+void speaker_get_stats(speaker_stats_t* out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// Blocks on the event queue with no timeout. While the DAC is down nothing posts to it,
+// so an idle speaker costs neither CPU nor DMA.
 void speaker_driver_play_task(void* pvParameters) {
     (void)pvParameters;
     ESP_LOGI(TAG, "Starting Speaker Task");
-    speaker_task_handle = xTaskGetCurrentTaskHandle();
 
-    while (1) {
-        uint32_t ulNotifiedValue;
-        BaseType_t xResult = xTaskNotifyWait(0, UINT32_MAX, &ulNotifiedValue, pdMS_TO_TICKS(30000));
+    QueueHandle_t queue = xQueueCreate(SPEAKER_EVENT_QUEUE_LEN, sizeof(speaker_event_t));
+    if (queue == NULL) {
+        ESP_LOGE(TAG, "FAILED TO CREATE EVENT QUEUE");
+        vTaskDelete(NULL);
+        return;
+    }
 
-        if (xResult == pdTRUE && ulNotifiedValue == SPEAKER_UL_VALUE) {
-            ESP_LOGI(TAG, "Sound triggered");
+    // Without events the play requests are counted as dropped
+    if (speaker_driver_init() != ESP_OK) {
+        vQueueDelete(queue);
+        vTaskDelete(NULL);
+        return;
+    }
+    events = queue;
+
+    while (1) {
+        speaker_event_t event;
+        if (xQueueReceive(events, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
         }
 
-        speaker_driver_init();
-        speaker_driver_play();
-        ESP_LOGI(TAG, "SOUND PLAYED");
-        speaker_driver_deinit();
+        switch (event.type) {
+        case SPEAKER_EVENT_PLAY:
+            _speaker_queue_request(&event);
+            if (!stats.powered) {
+                // Nothing plays without the DMA, the requests are dropped and the next
+                // one tries again
+                if (_speaker_power_up() != ESP_OK) {
+                    portENTER_CRITICAL(&stats_lock);
+                    stats.dropped += pending_count;
+                    portEXIT_CRITICAL(&stats_lock);
+                    pending_count = 0;
+                }
+            } else if (fading_out) {
+                // Caught before the DAC went down, fade back in from the silence
+                fading_out = false;
+                fading_in  = true;
+            }
+            break;
+
+        case SPEAKER_EVENT_STOP:
+            pending_count = 0;
+            audio_mixer_stop(&mixer);
+            break;
+
+        case SPEAKER_EVENT_VOLUME:
+            audio_mixer_set_volume(&mixer, (uint16_t)(event.volume * AUDIO_GAIN_UNITY / SPEAKER_VOLUME_MAX));
+
+            portENTER_CRITICAL(&stats_lock);
+            stats.volume = event.volume;
+            portEXIT_CRITICAL(&stats_lock);
+            break;
+
+        case SPEAKER_EVENT_DMA_DONE:
+            // Completions still queued when the DAC went down are stale
+            if (stats.powered) {
+                _speaker_refill(&event);
+            }
+            break;
+        }
     }
-}
\ No newline at end of file
+}
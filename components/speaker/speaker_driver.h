@@ -2,10 +2,68 @@
 
 #pragma once
 
+#include "audio_mixer.h"
+#include "esp_err.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
-#define SPEAKER_UL_VALUE 9
+// Two short DMA buffers keep the time from a play request to its first sample at a
+// couple of buffer lengths. The ESP32 DMA takes 16 bits per sample, so 128 bytes is 4 ms
+// at 16 kHz. The sample rate itself comes from the embedded clip, see CMakeLists.txt.
+#define SPEAKER_DMA_DESC_NUM 2
+#define SPEAKER_DMA_BUF_SIZE 128
+#define SPEAKER_MIX_SAMPLES (SPEAKER_DMA_BUF_SIZE / 2)
 
+// Requests waiting for a free voice, a full queue drops its lowest priority request
+#define SPEAKER_QUEUE_LEN 8
+
+// Commands and DMA completions share one queue, commands leave room for the DMA
+#define SPEAKER_EVENT_QUEUE_LEN 16
+
+// The DAC powers down once nothing is playing. Output fades to zero first and back
+// in on wake so neither end pops.
+#define SPEAKER_FADE_SAMPLES 32
+
+#define SPEAKER_VOLUME_MAX 100
+#define SPEAKER_VOLUME_STEP 10
+
+typedef enum {
+    SPEAKER_CLIP_READ_COMPLETE,
+    SPEAKER_CLIP_ERROR,
+    SPEAKER_CLIP_KEY_CLICK,
+    SPEAKER_CLIP_MAX
+} speaker_clip_id_t;
+
+// coalesced counts requests for a clip that was already waiting to play
+typedef struct {
+    uint32_t requested;
+    uint32_t played;
+    uint32_t dropped;
+    uint32_t coalesced;
+    uint32_t preempted;
+    uint32_t underruns;
+    uint32_t power_ups;
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    uint8_t volume;
+    bool powered;
+} speaker_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The clip must stay valid while registered, it is played in place. Clips built for
+// another sample rate are refused, nothing is resampled at runtime.
+esp_err_t speaker_register_clip(speaker_clip_id_t id, const audio_clip_t* clip);
+void speaker_play_clip(speaker_clip_id_t id);
 void speaker_play_sound(void);
-void speaker_driver_play_task(void* pvParameters);
\ No newline at end of file
+void speaker_stop(void);
+void speaker_set_volume(uint8_t percent);
+void speaker_get_stats(speaker_stats_t* stats);
+void speaker_driver_play_task(void* pvParameters);
+
+#ifdef __cplusplus
+}
+#endif
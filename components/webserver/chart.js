@@ -0,0 +1,196 @@
+// Minimal canvas line chart for the dashboard, replaces the Chart.js CDN dependency.
+// Each series has its own y axis (left or right) and shares the time axis.
+
+class LineChart {
+    constructor(canvas, options) {
+        this.canvas = canvas;
+        this.ctx = canvas.getContext('2d');
+        this.series = options.series;
+        this.xLabel = options.xLabel || '';
+        this.window = options.window || Infinity;
+        this.times = [];
+        this.values = this.series.map(() => []);
+        this.pending = false;
+
+        new ResizeObserver(() => this.update()).observe(canvas.parentElement);
+    }
+
+    setData(times, values) {
+        this.times = times.slice();
+        this.values = values.map(v => v.slice());
+        this.update();
+    }
+
+    // Points older than the window before the newest one are dropped
+    push(time, values) {
+        this.times.push(time);
+        values.forEach((v, i) => this.values[i].push(v));
+
+        while (this.times.length > 0 && this.times[0] < time - this.window) {
+            this.times.shift();
+            this.values.forEach(v => v.shift());
+        }
+        this.update();
+    }
+
+    replaceLast(values) {
+        if (this.times.length === 0) {
+            return;
+        }
+        values.forEach((v, i) => this.values[i][this.values[i].length - 1] = v);
+        this.update();
+    }
+
+    // Batches redraws into the next animation frame
+    update() {
+        if (!this.pending) {
+            this.pending = true;
+            requestAnimationFrame(() => {
+                this.pending = false;
+                this.draw();
+            });
+        }
+    }
+
+    resize() {
+        const ratio = window.devicePixelRatio || 1;
+        const parent = this.canvas.parentElement;
+        const style = getComputedStyle(parent);
+        this.width = parent.clientWidth - parseFloat(style.paddingLeft) - parseFloat(style.paddingRight);
+        this.height = parent.clientHeight - parseFloat(style.paddingTop) - parseFloat(style.paddingBottom);
+        this.canvas.width = Math.round(this.width * ratio);
+        this.canvas.height = Math.round(this.height * ratio);
+        this.canvas.style.display = 'block';
+        this.canvas.style.width = this.width + 'px';
+        this.canvas.style.height = this.height + 'px';
+        this.ctx.setTransform(ratio, 0, 0, ratio, 0, 0);
+    }
+
+    axisRange(series, values) {
+        let min = series.suggestedMin !== undefined ? series.suggestedMin : Infinity;
+        let max = series.suggestedMax !== undefined ? series.suggestedMax : -Infinity;
+        for (const v of values) {
+            if (v < min) min = v;
+            if (v > max) max = v;
+        }
+        if (!isFinite(min) || !isFinite(max)) {
+            return [0, 1];
+        }
+        return min === max ? [min - 1, max + 1] : [min, max];
+    }
+
+    // Keeps the first, min, max and last point of every pixel column, so the shape of
+    // thousands of samples survives while only a few points per column are stroked
+    decimate(values, x0, plotWidth, t0, tSpan) {
+        const points = [];
+        let column = -1;
+        let first, last, low, high;
+
+        const flush = () => {
+            if (column < 0) return;
+            const bucket = [first, low, high, last].sort((a, b) => a.i - b.i);
+            for (const p of bucket) {
+                if (points[points.length - 1] !== p) points.push(p);
+            }
+        };
+
+        for (let i = 0; i < values.length; i++) {
+            const x = x0 + ((this.times[i] - t0) / tSpan) * plotWidth;
+            const c = Math.floor(x);
+            const p = { i, x, v: values[i] };
+            if (c !== column) {
+                flush();
+                column = c;
+                first = low = high = p;
+            }
+            if (p.v < low.v) low = p;
+            if (p.v > high.v) high = p;
+            last = p;
+        }
+        flush();
+        return points;
+    }
+
+    draw() {
+        this.resize();
+
+        const ctx = this.ctx;
+        const pad = { left: 48, right: 48, top: 28, bottom: 36 };
+        const plotWidth = this.width - pad.left - pad.right;
+        const plotHeight = this.height - pad.top - pad.bottom;
+
+        ctx.clearRect(0, 0, this.width, this.height);
+        ctx.font = '11px sans-serif';
+        ctx.lineWidth = 1;
+
+        if (plotWidth <= 0 || plotHeight <= 0) {
+            return;
+        }
+
+        const t0 = this.times.length ? this.times[0] : 0;
+        const t1 = this.times.length ? this.times[this.times.length - 1] : 1;
+        const tSpan = Math.max(t1 - t0, 1);
+
+        // Grid and y axis ticks
+        ctx.strokeStyle = 'rgba(158, 158, 158, 0.2)';
+        ctx.fillStyle = '#9e9e9e';
+        const ticks = 5;
+        for (let k = 0; k <= ticks; k++) {
+            const y = pad.top + (plotHeight * k) / ticks;
+            ctx.beginPath();
+            ctx.moveTo(pad.left, y);
+            ctx.lineTo(pad.left + plotWidth, y);
+            ctx.stroke();
+        }
+
+        this.series.forEach((series, s) => {
+            const [min, max] = this.axisRange(series, this.values[s]);
+            const right = series.axis === 'right';
+
+            ctx.fillStyle = series.color;
+            ctx.textAlign = right ? 'left' : 'right';
+            ctx.textBaseline = 'middle';
+            for (let k = 0; k <= ticks; k++) {
+                const value = max - ((max - min) * k) / ticks;
+                const y = pad.top + (plotHeight * k) / ticks;
+                ctx.fillText(value.toFixed(0), right ? pad.left + plotWidth + 6 : pad.left - 6, y);
+            }
+
+            const points = this.decimate(this.values[s], pad.left, plotWidth, t0, tSpan);
+            ctx.strokeStyle = series.color;
+            ctx.lineWidth = 2;
+            ctx.beginPath();
+            points.forEach((p, n) => {
+                const y = pad.top + plotHeight * (1 - (p.v - min) / (max - min));
+                if (n === 0) ctx.moveTo(p.x, y);
+                else ctx.lineTo(p.x, y);
+            });
+            ctx.stroke();
+            ctx.lineWidth = 1;
+        });
+
+        // Time axis labels
+        ctx.fillStyle = '#9e9e9e';
+        ctx.textBaseline = 'top';
+        const labels = Math.max(2, Math.floor(plotWidth / 90));
+        for (let k = 0; k <= labels && this.times.length; k++) {
+            const t = t0 + (tSpan * k) / labels;
+            ctx.textAlign = k === 0 ? 'left' : (k === labels ? 'right' : 'center');
+            const label = new Date(t * 1000).toLocaleTimeString([], { hour: '2-digit', minute: '2-digit' });
+            ctx.fillText(label, pad.left + (plotWidth * k) / labels, pad.top + plotHeight + 6);
+        }
+        ctx.textAlign = 'center';
+        ctx.fillText(this.xLabel, pad.left + plotWidth / 2, pad.top + plotHeight + 20);
+
+        // Legend
+        let x = pad.left;
+        ctx.textAlign = 'left';
+        ctx.textBaseline = 'middle';
+        this.series.forEach(series => {
+            ctx.fillStyle = series.color;
+            ctx.fillRect(x, 8, 12, 12);
+            ctx.fillText(series.label, x + 16, 14);
+            x += ctx.measureText(series.label).width + 36;
+        });
+    }
+}
@@ -0,0 +1,229 @@
+// history_export.c
+
+#include "history_export.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define HISTORY_EXPORT_BATCH_SIZE 16
+
+typedef struct {
+    time_t start;
+    uint32_t count;
+    float temp_min, temp_max, temp_sum;
+    float hum_min, hum_max, hum_sum;
+} history_bucket_t;
+
+typedef struct {
+    stream_writer_t* writer;
+    const history_query_t* query;
+    uint32_t num_records;
+} history_exporter_t;
+
+esp_err_t history_format_parse(const char* name, history_format_t* format) {
+    if (strcmp(name, "json") == 0) {
+        *format = HISTORY_FORMAT_JSON;
+    } else if (strcmp(name, "csv") == 0) {
+        *format = HISTORY_FORMAT_CSV;
+    } else if (strcmp(name, "bin") == 0) {
+        *format = HISTORY_FORMAT_BIN;
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+const char* history_format_content_type(history_format_t format) {
+    switch (format) {
+        case HISTORY_FORMAT_CSV:
+            return "text/csv";
+        case HISTORY_FORMAT_BIN:
+            return "application/octet-stream";
+        default:
+            return "application/json";
+    }
+}
+
+static void _put_le16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void _put_le32(uint8_t* p, uint32_t value) {
+    _put_le16(p, value & 0xFFFF);
+    _put_le16(p + 2, value >> 16);
+}
+
+static uint16_t _centi(float value) {
+    return (uint16_t)(int16_t)lroundf(value * 100.0f);
+}
+
+static void _write_header(history_exporter_t* exp) {
+    stream_writer_t* w = exp->writer;
+    bool buckets       = exp->query->step > 0;
+
+    switch (exp->query->format) {
+        case HISTORY_FORMAT_JSON:
+            if (buckets) {
+                stream_writer_printf(w, "{\"step\":%lu,\"history\":[", (unsigned long)exp->query->step);
+            } else {
+                stream_writer_printf(w, "{\"history\":[");
+            }
+            break;
+        case HISTORY_FORMAT_CSV:
+            if (buckets) {
+                stream_writer_printf(w, "timestamp,count,temperature_min,temperature_max,temperature_avg,humidity_min,humidity_max,humidity_avg\n");
+            } else {
+                stream_writer_printf(w, "timestamp,temperature,humidity\n");
+            }
+            break;
+        case HISTORY_FORMAT_BIN: {
+            uint8_t header[HISTORY_BIN_HEADER_SIZE];
+            _put_le32(header, HISTORY_BIN_MAGIC);
+            header[4] = HISTORY_BIN_VERSION;
+            header[5] = buckets ? HISTORY_BIN_FLAG_BUCKETS : 0;
+            _put_le16(header + 6, buckets ? HISTORY_BIN_BUCKET_SIZE : HISTORY_BIN_SAMPLE_SIZE);
+            _put_le32(header + 8, exp->query->step);
+            stream_writer_write(w, header, sizeof(header));
+            break;
+        }
+    }
+}
+
+static void _write_footer(history_exporter_t* exp) {
+    if (exp->query->format == HISTORY_FORMAT_JSON) {
+        stream_writer_printf(exp->writer, "]}");
+    }
+}
+
+static void _write_sample(history_exporter_t* exp, const dht11_reading_t* reading) {
+    stream_writer_t* w = exp->writer;
+
+    switch (exp->query->format) {
+        case HISTORY_FORMAT_JSON:
+            stream_writer_printf(w, "%s{\"temperature\":%.2f,\"humidity\":%.1f,\"timestamp\":%lld}",
+                                 exp->num_records > 0 ? "," : "",
+                                 reading->temperature,
+                                 reading->humidity,
+                                 (long long)reading->timestamp);
+            break;
+        case HISTORY_FORMAT_CSV:
+            stream_writer_printf(w, "%lld,%.2f,%.1f\n", (long long)reading->timestamp, reading->temperature, reading->humidity);
+            break;
+        case HISTORY_FORMAT_BIN: {
+            uint8_t record[HISTORY_BIN_SAMPLE_SIZE];
+            _put_le32(record, (uint32_t)reading->timestamp);
+            _put_le16(record + 4, _centi(reading->temperature));
+            _put_le16(record + 6, _centi(reading->humidity));
+            stream_writer_write(w, record, sizeof(record));
+            break;
+        }
+    }
+    exp->num_records++;
+}
+
+static void _write_bucket(history_exporter_t* exp, const history_bucket_t* bucket) {
+    stream_writer_t* w = exp->writer;
+    float temp_avg     = bucket->temp_sum / bucket->count;
+    float hum_avg      = bucket->hum_sum / bucket->count;
+
+    switch (exp->query->format) {
+        case HISTORY_FORMAT_JSON:
+            stream_writer_printf(w, "%s{\"timestamp\":%lld,\"count\":%lu,"
+                                    "\"temperature\":{\"min\":%.2f,\"max\":%.2f,\"avg\":%.2f},"
+                                    "\"humidity\":{\"min\":%.1f,\"max\":%.1f,\"avg\":%.1f}}",
+                                 exp->num_records > 0 ? "," : "",
+                                 (long long)bucket->start,
+                                 (unsigned long)bucket->count,
+                                 bucket->temp_min, bucket->temp_max, temp_avg,
+                                 bucket->hum_min, bucket->hum_max, hum_avg);
+            break;
+        case HISTORY_FORMAT_CSV:
+            stream_writer_printf(w, "%lld,%lu,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f\n",
+                                 (long long)bucket->start,
+                                 (unsigned long)bucket->count,
+                                 bucket->temp_min, bucket->temp_max, temp_avg,
+                                 bucket->hum_min, bucket->hum_max, hum_avg);
+            break;
+        case HISTORY_FORMAT_BIN: {
+            uint8_t record[HISTORY_BIN_BUCKET_SIZE];
+            _put_le32(record, (uint32_t)bucket->start);
+            _put_le16(record + 4, bucket->count > UINT16_MAX ? UINT16_MAX : bucket->count);
+            _put_le16(record + 6, _centi(bucket->temp_min));
+            _put_le16(record + 8, _centi(bucket->temp_max));
+            _put_le16(record + 10, _centi(temp_avg));
+            _put_le16(record + 12, _centi(bucket->hum_min));
+            _put_le16(record + 14, _centi(bucket->hum_max));
+            _put_le16(record + 16, _centi(hum_avg));
+            stream_writer_write(w, record, sizeof(record));
+            break;
+        }
+    }
+    exp->num_records++;
+}
+
+static void _bucket_add(history_bucket_t* bucket, const dht11_reading_t* reading) {
+    if (bucket->count == 0) {
+        bucket->temp_min = bucket->temp_max = reading->temperature;
+        bucket->hum_min = bucket->hum_max = reading->humidity;
+        bucket->temp_sum = bucket->hum_sum = 0.0f;
+    }
+    bucket->temp_min = fminf(bucket->temp_min, reading->temperature);
+    bucket->temp_max = fmaxf(bucket->temp_max, reading->temperature);
+    bucket->hum_min  = fminf(bucket->hum_min, reading->humidity);
+    bucket->hum_max  = fmaxf(bucket->hum_max, reading->humidity);
+    bucket->temp_sum += reading->temperature;
+    bucket->hum_sum += reading->humidity;
+    bucket->count++;
+}
+
+esp_err_t history_export(stream_writer_t* writer, const history_query_t* query, history_read_fn_t read, void* ctx, uint32_t* num_records) {
+    history_exporter_t exp = {
+        .writer      = writer,
+        .query       = query,
+        .num_records = 0,
+    };
+    history_bucket_t bucket = {0};
+    dht11_reading_t batch[HISTORY_EXPORT_BATCH_SIZE];
+    bool done = false;
+    uint32_t n;
+
+    _write_header(&exp);
+
+    while (!done && writer->err == ESP_OK && (n = read(ctx, batch, HISTORY_EXPORT_BATCH_SIZE)) > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            const dht11_reading_t* reading = &batch[i];
+
+            if (reading->timestamp < query->from) {
+                continue;
+            }
+            if (reading->timestamp > query->to) {
+                done = true;
+                break;
+            }
+
+            if (query->step == 0) {
+                _write_sample(&exp, reading);
+                continue;
+            }
+
+            time_t start = reading->timestamp - (reading->timestamp % query->step);
+            if (bucket.count > 0 && start != bucket.start) {
+                _write_bucket(&exp, &bucket);
+                bucket.count = 0;
+            }
+            bucket.start = start;
+            _bucket_add(&bucket, reading);
+        }
+    }
+
+    if (bucket.count > 0) {
+        _write_bucket(&exp, &bucket);
+    }
+    _write_footer(&exp);
+
+    if (num_records) {
+        *num_records = exp.num_records;
+    }
+    return stream_writer_flush(writer);
+}
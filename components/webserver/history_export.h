@@ -0,0 +1,42 @@
+// history_export.h
+
+#pragma once
+
+#include "dht11_reading.h"
+#include "esp_err.h"
+#include "stream_writer.h"
+#include <stdint.h>
+#include <time.h>
+
+// Binary layout, all fields little-endian. Values are hundredths of a degree / percent.
+//   header:  u32 magic, u8 version, u8 flags, u16 record_size, u32 step
+//   sample:  u32 timestamp, i16 temperature, i16 humidity
+//   bucket:  u32 timestamp, u16 count, i16 temp min/max/avg, i16 humidity min/max/avg
+#define HISTORY_BIN_MAGIC        0x48544844 // "DHTH"
+#define HISTORY_BIN_VERSION      1
+#define HISTORY_BIN_FLAG_BUCKETS 0x01
+#define HISTORY_BIN_HEADER_SIZE  12
+#define HISTORY_BIN_SAMPLE_SIZE  8
+#define HISTORY_BIN_BUCKET_SIZE  18
+
+typedef enum {
+    HISTORY_FORMAT_JSON,
+    HISTORY_FORMAT_CSV,
+    HISTORY_FORMAT_BIN,
+} history_format_t;
+
+typedef struct {
+    time_t from;
+    time_t to;
+    uint32_t step; // Bucket width in seconds, 0 for raw samples
+    history_format_t format;
+} history_query_t;
+
+typedef uint32_t (*history_read_fn_t)(void* ctx, dht11_reading_t* buffer, uint32_t max);
+
+esp_err_t history_format_parse(const char* name, history_format_t* format);
+const char* history_format_content_type(history_format_t format);
+
+// Pulls readings from read() in time order and writes the ones inside [from, to], bucketed
+// into min/max/avg when step is set. num_records gets the number of samples or buckets sent.
+esp_err_t history_export(stream_writer_t* writer, const history_query_t* query, history_read_fn_t read, void* ctx, uint32_t* num_records);
@@ -1,114 +1,161 @@
-let myChart;
-const ctx = document.getElementById('sensorChart').getContext('2d');
+const HISTORY_WINDOW_S = 24 * 60 * 60;
+const HISTORY_STEP_S = 300;
+
+const myChart = new LineChart(document.getElementById('sensorChart'), {
+    xLabel: 'Time',
+    window: HISTORY_WINDOW_S,
+    series: [
+        { label: 'Temperature (°F)', color: 'rgba(255, 99, 132, 1)', axis: 'left', suggestedMin: 0, suggestedMax: 100 },
+        { label: 'Humidity (%)', color: 'rgba(54, 162, 235, 1)', axis: 'right', suggestedMin: 0, suggestedMax: 100 }
+    ]
+});
 const loader = document.getElementById('loader');
 const readNowBtn = document.getElementById('readNowButton');
 
-async function initializeChart() {
-    try {
-        const response = await fetch('/dht_history');
-        const data = await response.json();
+// Must match history_export.h
+const HISTORY_BIN_MAGIC = 0x48544844;
+const HISTORY_BIN_HEADER_SIZE = 12;
+const HISTORY_BIN_FLAG_BUCKETS = 0x01;
+
+function decodeHistory(buffer) {
+    const view = new DataView(buffer);
+    if (view.byteLength < HISTORY_BIN_HEADER_SIZE || view.getUint32(0, true) !== HISTORY_BIN_MAGIC) {
+        throw new Error("Malformed history response");
+    }
+
+    const buckets = (view.getUint8(5) & HISTORY_BIN_FLAG_BUCKETS) !== 0;
+    const recordSize = view.getUint16(6, true);
+    const history = [];
+
+    // Buckets carry min/max/avg, the chart plots the averages
+    const tempOffset = buckets ? 10 : 4;
+    const humidityOffset = buckets ? 16 : 6;
 
-        const labels = data.history.map(d => new Date(d.timestamp * 1000).toLocaleTimeString());
-        const tempData = data.history.map(d => d.temperature);
-        const humidityData = data.history.map(d => d.humidity);
-
-        myChart = new Chart(ctx, {
-            type: 'line',
-            data: {
-                labels: labels,
-                datasets: [{
-                    label: 'Temperature (°F)',
-                    data: tempData,
-                    borderColor: 'rgba(255, 99, 132, 1)',
-                    yAxisID: 'y'
-                }, {
-                    label: 'Humidity (%)',
-                    data: humidityData,
-                    borderColor: 'rgba(54, 162, 235, 1)',
-                    yAxisID: 'y1'
-                }]
-            },
-            options: {
-                responsive: true,
-                maintainAspectRatio: false,
-                scales: {
-                    x: { title: { display: true, text: 'Time' } },
-                    y: {
-                        type: 'linear',
-                        suggestedMin: 0,
-                        suggestedMax: 100,
-                        display: true,
-                        position: 'left',
-                        title: { display: true, text: 'Temperature (°F)' }
-                    },
-                    y1: {
-                        type: 'linear',
-                        suggestedMin: 0,
-                        suggestedMax: 100,
-                        display: true,
-                        position: 'right',
-                        title: { display: true, text: 'Humidity (%)' },
-                        grid: { drawOnChartArea: false }
-                    }
-                }
-            }
+    for (let offset = HISTORY_BIN_HEADER_SIZE; offset + recordSize <= view.byteLength; offset += recordSize) {
+        history.push({
+            timestamp: view.getUint32(offset, true),
+            count: buckets ? view.getUint16(offset + 4, true) : 1,
+            temperature: view.getInt16(offset + tempOffset, true) / 100,
+            humidity: view.getInt16(offset + humidityOffset, true) / 100
         });
-    } catch (error) {
-        console.error("Error initializing chart:", error);
     }
+    return history;
 }
 
-async function updateDHTdata() {
-    loader.classList.remove('hidden');
-    loader.classList.add('visible');
-    readNowBtn.disabled = true;
+async function loadHistory() {
     try {
-        const response = await fetch('/dht_data');
-        const data = await response.json();
+        const from = Math.max(0, Math.floor(Date.now() / 1000) - HISTORY_WINDOW_S);
+        const response = await fetch(`/dht_history?format=bin&from=${from}&step=${HISTORY_STEP_S}`);
+        const history = decodeHistory(await response.arrayBuffer());
 
-        document.getElementById('temperature').textContent = data.temperature.toFixed(2);
-        document.getElementById('humidity').textContent = data.humidity.toFixed(1);
+        myChart.setData(history.map(d => d.timestamp), [
+            history.map(d => d.temperature),
+            history.map(d => d.humidity)
+        ]);
 
-        const now = new Date();
-        const newLabel = now.toLocaleTimeString();
-        document.getElementById('lastupdated').textContent = newLabel;
+        // The newest bucket may still be filling, live readings continue it
+        const last = history[history.length - 1];
+        if (last) {
+            liveBucket = {
+                start: last.timestamp,
+                count: last.count,
+                temperature: last.temperature * last.count,
+                humidity: last.humidity * last.count
+            };
+        }
+    } catch (error) {
+        console.error("Error loading history:", error);
+    }
+}
 
-        console.log("Data updated successfully:", data);
+let lastSequence = null;
 
-        if (myChart) {
-            myChart.data.labels.push(newLabel);
-            myChart.data.datasets[0].data.push(data.temperature);
-            myChart.data.datasets[1].data.push(data.humidity);
+// Live readings are averaged into the same buckets the history was loaded with, so the
+// chart keeps one point per HISTORY_STEP_S across the whole window
+let liveBucket = null;
 
-            if (myChart.data.labels.length > 60) {
-                myChart.data.labels.shift();
-                myChart.data.datasets.forEach(dataset => dataset.data.shift());
-            }
+function chartReading(data) {
+    const start = data.timestamp - data.timestamp % HISTORY_STEP_S;
 
-            myChart.update();
-        }
+    if (liveBucket && liveBucket.start === start) {
+        liveBucket.count++;
+        liveBucket.temperature += data.temperature;
+        liveBucket.humidity += data.humidity;
+        myChart.replaceLast([liveBucket.temperature / liveBucket.count, liveBucket.humidity / liveBucket.count]);
+        return;
+    }
+
+    liveBucket = { start: start, count: 1, temperature: data.temperature, humidity: data.humidity };
+    myChart.push(start, [data.temperature, data.humidity]);
+}
 
+function setLoading(loading) {
+    loader.classList.toggle('visible', loading);
+    loader.classList.toggle('hidden', !loading);
+    readNowBtn.disabled = loading;
+}
+
+function applyReading(data, chart = true) {
+    document.getElementById('temperature').textContent = data.temperature.toFixed(2);
+    document.getElementById('humidity').textContent = data.humidity.toFixed(1);
+
+    const newLabel = new Date(data.timestamp * 1000).toLocaleTimeString();
+    document.getElementById('lastupdated').textContent = newLabel;
+
+    console.log("Data updated successfully:", data);
+
+    // A reconnect replays the latest reading, only chart it once
+    if (chart && data.sequence !== lastSequence) {
+        chartReading(data);
+    }
+    lastSequence = data.sequence;
+}
+
+function connectEvents() {
+    const events = new EventSource('/events');
+
+    // The first event replays the latest reading, which the loaded history already holds
+    let replay = true;
+    events.addEventListener('reading', event => {
+        applyReading(JSON.parse(event.data), !replay);
+        replay = false;
+    });
+
+    // EventSource reconnects on its own, this only reports the drop
+    events.onerror = () => console.warn("Event stream interrupted, reconnecting");
+}
+
+async function requestReading() {
+    setLoading(true);
+    try {
+        // Resolves once the sensor has taken a reading for this request
+        const response = await fetch('/dht_data');
+        const data = await response.json();
+        if (data.temperature === null) {
+            throw new Error("No reading available");
+        }
+        if (data.stale) {
+            console.warn("Sensor read failed, showing the last reading");
+        }
+        applyReading(data);
     } catch (error) {
         console.error("Error fetching DHT data:", error);
         document.getElementById('temperature').textContent = "Error";
         document.getElementById('humidity').textContent = "Error";
         document.getElementById('lastupdated').textContent = "Error";
     } finally {
-        loader.classList.remove('visible');
-        loader.classList.add('hidden');
-        readNowBtn.disabled = false;
+        setLoading(false);
     }
 }
 
 if (readNowBtn) {
     readNowBtn.addEventListener('click', () => {
         console.log("Read Now Button Clicked");
-        updateDHTdata();
+        requestReading();
     });
 }
 
-document.addEventListener('DOMContentLoaded', () => {
-    initializeChart();
-    updateDHTdata();
+document.addEventListener('DOMContentLoaded', async () => {
+    await loadHistory();
+    connectEvents();
 });
-setInterval(updateDHTdata, 60000);
\ No newline at end of file
@@ -0,0 +1,254 @@
+// sse.c
+
+#include "sse.h"
+#include "dht11_task.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+static const char* TAG = "SSE";
+
+// Events are queued per client and drained from the httpd task with non-blocking sends.
+// A client whose queue is still full when the next reading arrives is disconnected.
+typedef struct {
+    bool active;
+    bool evict;
+    int fd;
+    uint8_t head;
+    uint8_t count;
+    uint16_t offset;
+    uint16_t len[SSE_CLIENT_QUEUE_LEN];
+    char queue[SSE_CLIENT_QUEUE_LEN][SSE_EVENT_MAX_LEN];
+} sse_client_t;
+
+static httpd_handle_t s_server = NULL;
+static esp_timer_handle_t s_retry_timer = NULL;
+static sse_client_t s_clients[SSE_MAX_CLIENTS];
+static portMUX_TYPE s_clients_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char SSE_HEADERS[] = "HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: text/event-stream\r\n"
+                                  "Cache-Control: no-cache\r\n"
+                                  "Connection: keep-alive\r\n"
+                                  "\r\n";
+
+static int _sse_format_reading(char* buf, size_t size, const dht11_snapshot_t* snapshot) {
+    int len = snprintf(buf, size, "event: reading\ndata: {\"temperature\":%.2f,\"humidity\":%.1f,\"timestamp\":%lld,\"sequence\":%lu}\n\n",
+                       snapshot->temperature,
+                       snapshot->humidity,
+                       (long long)snapshot->timestamp,
+                       (unsigned long)snapshot->sequence);
+    if (len < 0 || len >= size) {
+        return -1;
+    }
+    return len;
+}
+
+static sse_client_t* _sse_client_alloc(int fd) {
+    sse_client_t* client = NULL;
+
+    portENTER_CRITICAL(&s_clients_lock);
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (!s_clients[i].active) {
+            client         = &s_clients[i];
+            client->active = true;
+            client->evict  = false;
+            client->fd     = fd;
+            client->head   = 0;
+            client->count  = 0;
+            client->offset = 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_clients_lock);
+
+    return client;
+}
+
+// Session free_ctx, runs when httpd closes the socket for any reason
+static void _sse_client_release(void* ctx) {
+    sse_client_t* client = (sse_client_t*)ctx;
+
+    portENTER_CRITICAL(&s_clients_lock);
+    client->active = false;
+    portEXIT_CRITICAL(&s_clients_lock);
+
+    ESP_LOGI(TAG, "Event stream on socket %d closed", client->fd);
+}
+
+// Sends whatever the client can take right now, returns false if it has to go
+static bool _sse_client_drain(sse_client_t* client) {
+    while (true) {
+        portENTER_CRITICAL(&s_clients_lock);
+        bool evict    = client->evict;
+        uint8_t count = client->count;
+        uint8_t head  = client->head;
+        portEXIT_CRITICAL(&s_clients_lock);
+
+        if (evict) {
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+
+        // Only this task pops, so the head slot is stable while it is being sent
+        const char* data = client->queue[head] + client->offset;
+        size_t len       = client->len[head] - client->offset;
+        int sent         = httpd_socket_send(s_server, client->fd, data, len, MSG_DONTWAIT);
+
+        if (sent == HTTPD_SOCK_ERR_TIMEOUT) {
+            return true;
+        }
+        if (sent < 0) {
+            return false;
+        }
+
+        client->offset += sent;
+        if (client->offset < client->len[head]) {
+            return true;
+        }
+
+        portENTER_CRITICAL(&s_clients_lock);
+        client->offset = 0;
+        client->head   = (client->head + 1) % SSE_CLIENT_QUEUE_LEN;
+        client->count--;
+        portEXIT_CRITICAL(&s_clients_lock);
+    }
+}
+
+static void _sse_flush_work(void* arg) {
+    bool backlog = false;
+
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        sse_client_t* client = &s_clients[i];
+
+        portENTER_CRITICAL(&s_clients_lock);
+        bool active = client->active;
+        portEXIT_CRITICAL(&s_clients_lock);
+
+        if (!active) {
+            continue;
+        }
+        if (!_sse_client_drain(client)) {
+            ESP_LOGW(TAG, "Evicting slow event stream on socket %d", client->fd);
+            httpd_sess_trigger_close(s_server, client->fd);
+            continue;
+        }
+
+        portENTER_CRITICAL(&s_clients_lock);
+        backlog |= client->count > 0;
+        portEXIT_CRITICAL(&s_clients_lock);
+    }
+
+    // A socket that was full would otherwise keep the rest until the next reading, while
+    // its queue fills towards eviction. Fails harmlessly if a retry is already pending.
+    if (backlog) {
+        esp_timer_start_once(s_retry_timer, SSE_FLUSH_RETRY_MS * 1000);
+    }
+}
+
+// Runs on the esp_timer task, the sends themselves stay on the httpd task
+static void _sse_retry_flush(void* arg) {
+    if (httpd_queue_work(s_server, _sse_flush_work, NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to queue event flush retry");
+    }
+}
+
+// Runs on the DHT11 task, formats the event once and fans it out to every client queue
+static void _sse_on_reading(const dht11_snapshot_t* snapshot, void* ctx) {
+    char event[SSE_EVENT_MAX_LEN];
+    int len = _sse_format_reading(event, sizeof(event), snapshot);
+    if (len < 0) {
+        return;
+    }
+
+    bool pending = false;
+
+    portENTER_CRITICAL(&s_clients_lock);
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        sse_client_t* client = &s_clients[i];
+        if (!client->active || client->evict) {
+            continue;
+        }
+        if (client->count == SSE_CLIENT_QUEUE_LEN) {
+            client->evict = true;
+        } else {
+            uint8_t tail = (client->head + client->count) % SSE_CLIENT_QUEUE_LEN;
+            memcpy(client->queue[tail], event, len);
+            client->len[tail] = len;
+            client->count++;
+        }
+        pending = true;
+    }
+    portEXIT_CRITICAL(&s_clients_lock);
+
+    if (pending && httpd_queue_work(s_server, _sse_flush_work, NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to queue event flush");
+    }
+}
+
+static esp_err_t _events_get_handler(httpd_req_t* req) {
+    int fd               = httpd_req_to_sockfd(req);
+    sse_client_t* client = _sse_client_alloc(fd);
+
+    if (client == NULL) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_send(req, "Too many event streams", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+
+    // Headers are written raw so the response never completes, httpd then just sees an
+    // idle keep-alive socket and the client is released through the session context
+    if (httpd_send(req, SSE_HEADERS, sizeof(SSE_HEADERS) - 1) < 0) {
+        _sse_client_release(client);
+        return ESP_FAIL;
+    }
+    req->sess_ctx = client;
+    req->free_ctx = _sse_client_release;
+
+    char event[SSE_EVENT_MAX_LEN];
+    int len = snprintf(event, sizeof(event), "retry: %d\n\n", SSE_RETRY_MS);
+    httpd_send(req, event, len);
+
+    // Seed the new client with the latest reading so the page doesn't wait a whole period
+    dht11_snapshot_t snapshot;
+    dht11_get_snapshot(&snapshot);
+    if (!isnan(snapshot.temperature) && (len = _sse_format_reading(event, sizeof(event), &snapshot)) > 0) {
+        httpd_send(req, event, len);
+    }
+
+    ESP_LOGI(TAG, "Event stream opened on socket %d", fd);
+    return ESP_OK;
+}
+
+static const httpd_uri_t events_uri = {
+    .uri     = "/events",
+    .method  = HTTP_GET,
+    .handler = _events_get_handler,
+};
+
+esp_err_t sse_start(httpd_handle_t server) {
+    s_server = server;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = _sse_retry_flush,
+        .name     = "sse_retry",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &s_retry_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create flush retry timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = httpd_register_uri_handler(server, &events_uri);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return dht11_add_listener(_sse_on_reading, NULL);
+}
@@ -0,0 +1,15 @@
+// sse.h
+
+#pragma once
+
+#include "esp_http_server.h"
+
+#define SSE_MAX_CLIENTS      4
+#define SSE_CLIENT_QUEUE_LEN 4
+#define SSE_EVENT_MAX_LEN    160
+#define SSE_RETRY_MS         5000
+// A client that couldn't take a whole event is tried again after this long
+#define SSE_FLUSH_RETRY_MS   50
+
+// Registers /events and subscribes it to new DHT11 readings
+esp_err_t sse_start(httpd_handle_t server);
@@ -0,0 +1,71 @@
+// stream_writer.c
+
+#include "stream_writer.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+void stream_writer_init(stream_writer_t* writer, stream_writer_flush_t flush, void* ctx) {
+    writer->len   = 0;
+    writer->flush = flush;
+    writer->ctx   = ctx;
+    writer->err   = ESP_OK;
+}
+
+esp_err_t stream_writer_flush(stream_writer_t* writer) {
+    if (writer->err == ESP_OK && writer->len > 0) {
+        writer->err = writer->flush(writer->ctx, writer->buf, writer->len);
+    }
+    writer->len = 0;
+    return writer->err;
+}
+
+esp_err_t stream_writer_write(stream_writer_t* writer, const void* data, size_t len) {
+    const char* bytes = (const char*)data;
+
+    while (writer->err == ESP_OK && len > 0) {
+        size_t space = sizeof(writer->buf) - writer->len;
+        if (space == 0) {
+            stream_writer_flush(writer);
+            continue;
+        }
+        size_t n = len < space ? len : space;
+        memcpy(writer->buf + writer->len, bytes, n);
+        writer->len += n;
+        bytes += n;
+        len -= n;
+    }
+    return writer->err;
+}
+
+esp_err_t stream_writer_printf(stream_writer_t* writer, const char* fmt, ...) {
+    if (writer->err != ESP_OK) {
+        return writer->err;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = sizeof(writer->buf) - writer->len;
+
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(writer->buf + writer->len, space, fmt, args);
+        va_end(args);
+
+        if (len < 0) {
+            writer->err = ESP_FAIL;
+            return writer->err;
+        }
+        if ((size_t)len < space) {
+            writer->len += len;
+            return ESP_OK;
+        }
+
+        // Didn't fit, drop the partial output and retry on an empty buffer
+        if (stream_writer_flush(writer) != ESP_OK) {
+            return writer->err;
+        }
+    }
+
+    writer->err = ESP_ERR_INVALID_SIZE;
+    return writer->err;
+}
@@ -0,0 +1,25 @@
+// stream_writer.h
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+#define STREAM_WRITER_BUF_SIZE 512
+
+typedef esp_err_t (*stream_writer_flush_t)(void* ctx, const char* data, size_t len);
+
+// Small fixed buffer in front of a chunked sink, so a response of any length is built
+// with constant memory. The first error sticks and turns later calls into no-ops.
+typedef struct {
+    char buf[STREAM_WRITER_BUF_SIZE];
+    size_t len;
+    stream_writer_flush_t flush;
+    void* ctx;
+    esp_err_t err;
+} stream_writer_t;
+
+void stream_writer_init(stream_writer_t* writer, stream_writer_flush_t flush, void* ctx);
+esp_err_t stream_writer_write(stream_writer_t* writer, const void* data, size_t len);
+esp_err_t stream_writer_printf(stream_writer_t* writer, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+esp_err_t stream_writer_flush(stream_writer_t* writer);
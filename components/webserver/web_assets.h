@@ -0,0 +1,18 @@
+// web_assets.h
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Gzipped UI files, generated at build time by web_assets_gen.py
+typedef struct {
+    const char* uri;
+    const char* content_type;
+    const uint8_t* data;
+    size_t len;
+    const char* etag;
+} web_asset_t;
+
+extern const web_asset_t web_assets[];
+extern const size_t web_assets_count;
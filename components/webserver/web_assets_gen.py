@@ -0,0 +1,52 @@
+# Gzips the web UI files and writes them out as a C table with strong ETags.
+# usage: web_assets_gen.py OUTPUT.c FILE [FILE ...]
+
+import gzip
+import hashlib
+import os
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+}
+
+
+def c_array(name, data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "static const uint8_t %s[%d] = {\n%s\n};\n" % (name, len(data), "\n".join(lines))
+
+
+def main():
+    out_path = sys.argv[1]
+    entries = []
+    arrays = []
+
+    for index, path in enumerate(sys.argv[2:]):
+        name = os.path.basename(path)
+        ext = os.path.splitext(name)[1]
+        with open(path, "rb") as f:
+            raw = f.read()
+
+        # mtime=0 keeps the output, and so the ETag, identical across rebuilds
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '"%s"' % hashlib.sha256(data).hexdigest()[:16]
+
+        arrays.append(c_array("s_asset_%d" % index, data))
+        entries.append('    {"/%s", "%s", s_asset_%d, sizeof(s_asset_%d), "%s"},'
+                       % (name, CONTENT_TYPES.get(ext, "application/octet-stream"), index, index, etag.replace('"', '\\"')))
+        print("%s: %d -> %d bytes, ETag %s" % (name, len(raw), len(data), etag))
+
+    with open(out_path, "w") as f:
+        f.write("// Generated by web_assets_gen.py, do not edit\n\n")
+        f.write('#include "web_assets.h"\n\n')
+        f.write("\n".join(arrays))
+        f.write("\nconst web_asset_t web_assets[] = {\n%s\n};\n\n" % "\n".join(entries))
+        f.write("const size_t web_assets_count = %d;\n" % len(entries))
+
+
+if __name__ == "__main__":
+    main()
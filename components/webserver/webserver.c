@@ -5,103 +5,139 @@
 #include "esp_err.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "history_export.h"
+#include "i2cbus.h"
+#include "speaker_driver.h"
+#include "sse.h"
+#include "web_assets.h"
+#include "stream_writer.h"
 #include <freertos/task.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char* TAG = "WEB_SERVER";
-extern const uint8_t _binary_index_html_start[] asm("_binary_index_html_start");
-extern const uint8_t _binary_index_html_end[] asm("_binary_index_html_end");
-extern const uint8_t _binary_style_css_start[] asm("_binary_style_css_start");
-extern const uint8_t _binary_style_css_end[] asm("_binary_style_css_end");
-extern const uint8_t _binary_script_js_start[] asm("_binary_script_js_start");
-extern const uint8_t _binary_script_js_end[] asm("_binary_script_js_end");
 
-static esp_err_t _dht_history_get_handler(httpd_req_t* req) {
-    dht11_reading_t* history_buffer = malloc(sizeof(dht11_reading_t) * DHT_HISTORY_SIZE);
+#define HISTORY_QUERY_MAX_LEN 96
+#define HISTORY_TIME_MAX      ((time_t)UINT32_MAX)
+#define ETAG_HEADER_MAX_LEN   128
+#define WEB_INDEX_URI         "/index.html"
+#define WEB_MAX_URI_HANDLERS  12
+
+static esp_err_t _send_chunk(void* ctx, const char* data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t*)ctx, data, len);
+}
+
+static uint32_t _history_read(void* ctx, dht11_reading_t* buffer, uint32_t max) {
+    return dht11_history_read((dht11_history_cursor_t*)ctx, buffer, max);
+}
+
+static bool _query_int(const char* query, const char* key, long long min, long long* value) {
+    char param[24];
+    char* end;
+
+    if (httpd_query_key_value(query, key, param, sizeof(param)) != ESP_OK) {
+        return true;
+    }
+    *value = strtoll(param, &end, 10);
+    return end != param && *end == '\0' && *value >= min;
+}
 
-    char* json_response = malloc(2048);
+static esp_err_t _parse_history_query(httpd_req_t* req, history_query_t* query) {
+    char buf[HISTORY_QUERY_MAX_LEN];
+    char param[8];
+    long long from = 0;
+    long long to   = LLONG_MAX;
+    long long step = 0;
 
-    if (history_buffer == NULL || json_response == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for history handler!");
-        if (history_buffer) {
-            free(history_buffer);
+    query->format = HISTORY_FORMAT_JSON;
+
+    size_t len = httpd_req_get_url_query_len(req);
+    if (len > 0) {
+        if (len >= sizeof(buf) || httpd_req_get_url_query_str(req, buf, sizeof(buf)) != ESP_OK) {
+            return ESP_ERR_INVALID_SIZE;
         }
-        if (json_response) {
-            free(json_response);
+        if (!_query_int(buf, "from", 0, &from) || !_query_int(buf, "to", 0, &to) ||
+            !_query_int(buf, "step", 0, &step) || step > UINT32_MAX || to < from) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (httpd_query_key_value(buf, "format", param, sizeof(param)) == ESP_OK &&
+            history_format_parse(param, &query->format) != ESP_OK) {
+            return ESP_ERR_INVALID_ARG;
         }
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
-        return ESP_FAIL;
     }
 
-    uint32_t number_of_readings = 0;
-    dht11_get_history(history_buffer, &number_of_readings);
+    query->from = (time_t)from;
+    query->to   = to > (long long)HISTORY_TIME_MAX ? HISTORY_TIME_MAX : (time_t)to;
 
-    char* p         = json_response;
-    const char* end = json_response + 2048;
-    int len;
+    // Buckets no finer than the sample period would hold one reading each, send raw samples instead
+    query->step = step * 1000 > DHT11_SAMPLE_PERIOD_MS ? (uint32_t)step : 0;
 
-    ESP_LOGI(TAG, "Fetching %ld history readings.", number_of_readings);
+    return ESP_OK;
+}
 
-    len = snprintf(p, end - p, "{\"history\":[");
-    if (len < 0 || len >= (end - p)) {
-        ESP_LOGE(TAG, "snprintf failed during JSON creation");
-        goto cleanup;
-    }
-    p += len;
+static esp_err_t _dht_history_get_handler(httpd_req_t* req) {
+    history_query_t query;
+    stream_writer_t writer;
+    dht11_history_cursor_t cursor;
+    uint32_t num_records = 0;
 
-    for (int i = 0; i < number_of_readings; i++) {
-        len = snprintf(p, end - p, "{\"temperature\":%.2f,\"humidity\":%.1f,\"timestamp\":%lld}",
-                       history_buffer[i].temperature,
-                       history_buffer[i].humidity,
-                       (long long)history_buffer[i].timestamp);
+    if (_parse_history_query(req, &query) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid history query");
+        return ESP_FAIL;
+    }
 
-        if (len < 0 || len >= (end - p)) {
-            goto cleanup;
-        }
-        p += len;
+    httpd_resp_set_type(req, history_format_content_type(query.format));
+    stream_writer_init(&writer, _send_chunk, req);
 
-        if (i < number_of_readings - 1) {
-            if ((end - p) < 2) {
-                goto cleanup;
-            }
-            *p++ = ',';
-        }
+    // Readings are copied out in small batches, the history lock is only held per batch
+    dht11_history_seek(query.from, &cursor);
+    if (history_export(&writer, &query, _history_read, &cursor, &num_records) != ESP_OK) {
+        ESP_LOGE(TAG, "History stream aborted after %" PRIu32 " records: %s", num_records, esp_err_to_name(writer.err));
+        return ESP_FAIL;
     }
 
-    if ((end - p) < 3) {
-        goto cleanup;
+    // The client only knows the stream is complete once the terminating chunk arrives
+    esp_err_t ret = httpd_resp_send_chunk(req, NULL, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "History stream not terminated after %" PRIu32 " records: %s", num_records, esp_err_to_name(ret));
+        return ESP_FAIL;
     }
-    *p++ = ']';
-    *p++ = '}';
-    *p   = '\0';
-
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_response, strlen(json_response));
-    ESP_LOGI(TAG, "Sent history data.");
-
-cleanup:
-    free(history_buffer);
-    free(json_response);
+    ESP_LOGI(TAG, "Sent %" PRIu32 " history records.", num_records);
 
     return ESP_OK;
 }
 
-static esp_err_t _dht_data_get_handler(httpd_req_t* req) {
-    int len;
-    dht11_notify_read();
-
-    vTaskDelay(pdMS_TO_TICKS(500));
+// An on-demand read can take seconds when the sensor needs retries, so /dht_data is
+// answered asynchronously and the server task stays free for other clients meanwhile
+typedef struct {
+    httpd_req_t* req;
+    dht11_read_ticket_t ticket;
+} dht_data_request_t;
 
-    float temperature = dht11_get_temperature();
-    float humidity    = dht11_get_humidity();
+// Falls back to the last reading, flagged stale, when the on-demand read failed
+static esp_err_t _send_dht_data(httpd_req_t* req, esp_err_t result, const dht11_snapshot_t* fresh) {
+    int len;
+    dht11_snapshot_t reading;
+    bool stale = result != ESP_OK;
+
+    if (stale) {
+        ESP_LOGW(TAG, "On-demand read failed (%s), replying with the last reading", esp_err_to_name(result));
+        dht11_get_snapshot(&reading);
+    } else {
+        reading = *fresh;
+    }
 
-    char json_response[64];
-    if (isnan(temperature) || isnan(humidity)) {
-        len = snprintf(json_response, sizeof(json_response), "{\"temperature\": null, \"humidity\": null}");
+    char json_response[144];
+    if (isnan(reading.temperature) || isnan(reading.humidity)) {
+        len = snprintf(json_response, sizeof(json_response), "{\"temperature\": null, \"humidity\": null, \"stale\": true}");
+    } else {
+        len = snprintf(json_response, sizeof(json_response), "{\"temperature\": %.2f, \"humidity\": %.1f, \"timestamp\": %lld, \"sequence\": %" PRIu32 ", \"stale\": %s}",
+                       reading.temperature, reading.humidity, (long long)reading.timestamp, reading.sequence, stale ? "true" : "false");
     }
-    len = snprintf(json_response, sizeof(json_response), "{\"temperature\": %.2f, \"humidity\": %.1f}", temperature, humidity);
 
     if (len < 0 || len >= sizeof(json_response)) {
         ESP_LOGE(TAG, "JSON response buffer too small or snprintf error!");
@@ -116,50 +152,139 @@ static esp_err_t _dht_data_get_handler(httpd_req_t* req) {
     return ESP_OK;
 }
 
-static esp_err_t _root_get_handler(httpd_req_t* req) {
-    ESP_LOGI(TAG, "Serving root page (/)");
+// Runs on the server task
+static void _dht_data_send_work(void* arg) {
+    dht_data_request_t* request = (dht_data_request_t*)arg;
 
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, (const char*)_binary_index_html_start, _binary_index_html_end - _binary_index_html_start);
+    _send_dht_data(request->req, request->ticket.result, &request->ticket.snapshot);
+    httpd_req_async_handler_complete(request->req);
+    free(request);
+}
 
-    return ESP_OK;
+// Runs on the sensor task, hands the reply over to the server task
+static void _dht_data_read_done(dht11_read_ticket_t* ticket) {
+    dht_data_request_t* request = (dht_data_request_t*)ticket->ctx;
+
+    if (httpd_queue_work(request->req->handle, _dht_data_send_work, request) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue the /dht_data reply, dropping the request");
+        httpd_req_async_handler_complete(request->req);
+        free(request);
+    }
 }
 
-static esp_err_t _style_css_get_handler(httpd_req_t* req) {
-    ESP_LOGI(TAG, "Serving style.css");
+static esp_err_t _dht_data_get_handler(httpd_req_t* req) {
+    dht_data_request_t* request = calloc(1, sizeof(*request));
 
-    httpd_resp_set_type(req, "text/css");
-    httpd_resp_send(req, (const char*)_binary_style_css_start, _binary_style_css_end - _binary_style_css_start);
+    if (request == NULL || httpd_req_async_handler_begin(req, &request->req) != ESP_OK) {
+        free(request);
+        return _send_dht_data(req, ESP_ERR_NO_MEM, NULL);
+    }
+
+    // Waits for a reading taken after this request, concurrent requests share one read
+    esp_err_t ret = dht11_request_read_async(&request->ticket, _dht_data_read_done, request);
+    if (ret != ESP_OK) {
+        ret = _send_dht_data(request->req, ret, NULL);
+        httpd_req_async_handler_complete(request->req);
+        free(request);
+        return ret;
+    }
 
     return ESP_OK;
 }
 
-static esp_err_t _script_js_get_handler(httpd_req_t* req) {
-    ESP_LOGI(TAG, "Serving script.js");
+static esp_err_t _diagnostics_get_handler(httpd_req_t* req) {
+    stream_writer_t writer;
+    speaker_stats_t speaker;
+    i2cbus_stats_t i2c[I2C_BUS_MAX_DEVICES];
+
+    speaker_get_stats(&speaker);
+    size_t i2c_count = i2cbus_get_stats(i2c, I2C_BUS_MAX_DEVICES);
 
-    httpd_resp_set_type(req, "application/javascript");
-    httpd_resp_send(req, (const char*)_binary_script_js_start, _binary_script_js_end - _binary_script_js_start);
+    httpd_resp_set_type(req, "application/json");
+    stream_writer_init(&writer, _send_chunk, req);
+
+    stream_writer_printf(&writer,
+                         "{\"speaker\": {\"requested\": %" PRIu32 ", \"played\": %" PRIu32 ", \"dropped\": %" PRIu32
+                         ", \"coalesced\": %" PRIu32 ", \"preempted\": %" PRIu32 ", \"underruns\": %" PRIu32
+                         ", \"power_ups\": %" PRIu32 ", \"last_latency_us\": %" PRIu32 ", \"max_latency_us\": %" PRIu32
+                         ", \"volume\": %u, \"powered\": %s}, \"i2c\": [",
+                         speaker.requested, speaker.played, speaker.dropped, speaker.coalesced, speaker.preempted,
+                         speaker.underruns, speaker.power_ups, speaker.last_latency_us, speaker.max_latency_us,
+                         speaker.volume, speaker.powered ? "true" : "false");
+
+    for (size_t i = 0; i < i2c_count; i++) {
+        stream_writer_printf(&writer,
+                             "%s{\"name\": \"%s\", \"address\": %u, \"scl_hz\": %" PRIu32 ", \"transactions\": %" PRIu32
+                             ", \"bytes\": %" PRIu32 ", \"errors\": %" PRIu32 ", \"timeouts\": %" PRIu32
+                             ", \"fallbacks\": %" PRIu32 ", \"busy_us\": %" PRIu64 "}",
+                             i > 0 ? ", " : "", i2c[i].name, i2c[i].address, i2c[i].scl_hz, i2c[i].transactions,
+                             i2c[i].bytes, i2c[i].errors, i2c[i].timeouts, i2c[i].fallbacks, i2c[i].busy_us);
+    }
+
+    stream_writer_printf(&writer, "]}");
+    if (stream_writer_flush(&writer) != ESP_OK) {
+        ESP_LOGE(TAG, "Diagnostics response aborted: %s", esp_err_to_name(writer.err));
+        return ESP_FAIL;
+    }
 
+    esp_err_t ret = httpd_resp_send_chunk(req, NULL, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Diagnostics response not terminated: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
     return ESP_OK;
 }
 
-httpd_uri_t root_uri = {
-    .uri     = "/",
-    .method  = HTTP_GET,
-    .handler = _root_get_handler,
-};
+static bool _etag_matches(httpd_req_t* req, const char* etag) {
+    char if_none_match[ETAG_HEADER_MAX_LEN];
 
-httpd_uri_t style_css_uri = {
-    .uri     = "/style.css",
-    .method  = HTTP_GET,
-    .handler = _style_css_get_handler,
-};
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) != ESP_OK) {
+        return false;
+    }
+    return strcmp(if_none_match, "*") == 0 || strstr(if_none_match, etag) != NULL;
+}
 
-httpd_uri_t script_js_uri = {
-    .uri     = "/script.js",
-    .method  = HTTP_GET,
-    .handler = _script_js_get_handler,
-};
+// Serves one of the gzipped build-time assets, the browser revalidates on every load
+// and gets an empty 304 while the firmware hasn't changed
+static esp_err_t _asset_get_handler(httpd_req_t* req) {
+    const web_asset_t* asset = (const web_asset_t*)req->user_ctx;
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (_etag_matches(req, asset->etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    ESP_LOGI(TAG, "Serving %s", asset->uri);
+
+    httpd_resp_set_type(req, asset->content_type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char*)asset->data, asset->len);
+}
+
+static esp_err_t _register_assets(httpd_handle_t server) {
+    for (size_t i = 0; i < web_assets_count; i++) {
+        const web_asset_t* asset = &web_assets[i];
+        httpd_uri_t uri = {
+            .uri      = asset->uri,
+            .method   = HTTP_GET,
+            .handler  = _asset_get_handler,
+            .user_ctx = (void*)asset,
+        };
+
+        esp_err_t ret = httpd_register_uri_handler(server, &uri);
+        if (ret == ESP_OK && strcmp(asset->uri, WEB_INDEX_URI) == 0) {
+            uri.uri = "/";
+            ret     = httpd_register_uri_handler(server, &uri);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
 
 httpd_uri_t dht_data_uri = {
     .uri     = "/dht_data",
@@ -173,17 +298,24 @@ httpd_uri_t dht_history_uri = {
     .handler = _dht_history_get_handler,
 };
 
+httpd_uri_t diagnostics_uri = {
+    .uri     = "/diagnostics",
+    .method  = HTTP_GET,
+    .handler = _diagnostics_get_handler,
+};
+
 httpd_handle_t start_webserver() {
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = WEB_MAX_URI_HANDLERS;
 
     ESP_LOGI(TAG, "Starting HTTP Server");
     ESP_ERROR_CHECK(httpd_start(&server, &config));
-    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &root_uri));
-    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &style_css_uri));
-    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &script_js_uri));
+    ESP_ERROR_CHECK(_register_assets(server));
     ESP_ERROR_CHECK(httpd_register_uri_handler(server, &dht_data_uri));
     ESP_ERROR_CHECK(httpd_register_uri_handler(server, &dht_history_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &diagnostics_uri));
+    ESP_ERROR_CHECK(sse_start(server));
 
     if (server != NULL) {
         ESP_LOGI(TAG, "Server start successful");
@@ -5,7 +5,9 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "i2cbus.h"
 #include "irdecoder.h"
+#include "keyevent.h"
 #include "lcd_task.h"
 #include "speaker_driver.h"
 #include "statusled.h"
@@ -18,6 +20,9 @@
 #define BUTTON_TASK_PRIORITY 12
 #define IR_DECODER_TASK_PRIORITY 9
 #define SPEAKER_TASK_PRIORITY 13
+#define KEY_ACTION_TASK_PRIORITY 11
+
+#define KEY_ACTION_QUEUE_LENGTH 8
 
 static const char* TAG = "APP_MAIN";
 
@@ -26,6 +31,7 @@ TaskHandle_t lcd_task_handle        = NULL;
 TaskHandle_t button_task_handle     = NULL;
 TaskHandle_t ir_decoder_task_handle = NULL;
 TaskHandle_t speaker_task_handle    = NULL;
+TaskHandle_t key_action_task_handle = NULL;
 
 void create_task_or_fail(TaskFunction_t task_func, const char* name, uint32_t stack, void* params, UBaseType_t priority, TaskHandle_t* handle) {
     BaseType_t result = xTaskCreate(task_func, name, stack, params, priority, handle);
@@ -37,6 +43,49 @@ void create_task_or_fail(TaskFunction_t task_func, const char* name, uint32_t st
     }
 }
 
+// Short button clicks cycle the LCD mode and a long press takes a reading. On the remote,
+// holding CYCLE keeps cycling and holding +/- keeps stepping the volume at the auto-repeat rate.
+static void key_action_task(void* pvParameters) {
+    QueueHandle_t events = (QueueHandle_t)pvParameters;
+    key_event_t event;
+
+    while (1) {
+        if (xQueueReceive(events, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        if (event.type == KEY_EVENT_PRESS) {
+            speaker_play_clip(SPEAKER_CLIP_KEY_CLICK);
+        }
+
+        if (event.source == KEY_SOURCE_BUTTON) {
+            if (event.type == KEY_EVENT_RELEASE && !event.long_press) {
+                lcd_cycle_mode();
+            } else if (event.type == KEY_EVENT_LONG_PRESS) {
+                dht11_notify_read();
+            }
+            continue;
+        }
+
+        if (event.code == BUTTON_CYCLE && (event.type == KEY_EVENT_PRESS || event.type == KEY_EVENT_REPEAT)) {
+            lcd_cycle_mode();
+        } else if (event.code == BUTTON_FORWARD && event.type == KEY_EVENT_PRESS) {
+            dht11_notify_read();
+        } else if (event.code == BUTTON_EQ && event.type == KEY_EVENT_PRESS) {
+            speaker_play_sound();
+        } else if ((event.code == BUTTON_PLUS || event.code == BUTTON_MINUS) &&
+                   (event.type == KEY_EVENT_PRESS || event.type == KEY_EVENT_REPEAT)) {
+            speaker_stats_t speaker;
+            speaker_get_stats(&speaker);
+
+            int volume = speaker.volume + (event.code == BUTTON_PLUS ? SPEAKER_VOLUME_STEP : -SPEAKER_VOLUME_STEP);
+            speaker_set_volume(volume < 0 ? 0 : volume);
+        } else if (event.code == BUTTON_MUTE && event.type == KEY_EVENT_PRESS) {
+            speaker_stop();
+        }
+    }
+}
+
 void app_main(void) {
     ESP_LOGI(TAG, "Application Starting");
     status_led_init();
@@ -49,14 +98,28 @@ void app_main(void) {
     status_led_set_state(STATUS_LED_STATE_IN_PROGRESS);
     start_webserver();
 
+    // The LCD task attaches to the bus, so the bus and its lock have to exist first
+    if (i2cbus_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize I2C bus");
+        status_led_set_state(STATUS_LED_STATE_ERROR);
+    }
     create_task_or_fail(lcd_display_task, "LCD Displayer", 4096, NULL, LCD_TASK_PRIORITY, &lcd_task_handle);
 
-    if (start_dht11_sensor_task(lcd_task_handle) == ESP_OK) {
+    if (start_dht11_sensor_task() == ESP_OK) {
         ESP_LOGI(TAG, "DHT11 sensor task started successfully.");
     } else {
         ESP_LOGE(TAG, "Failed to start DHT11 sensor task.");
     }
 
+    // Subscribed before the key sources start so no early press is lost
+    QueueHandle_t key_events = xQueueCreate(KEY_ACTION_QUEUE_LENGTH, sizeof(key_event_t));
+    if (key_events != NULL && key_event_subscribe(key_events) == ESP_OK) {
+        create_task_or_fail(key_action_task, "Key Actions", 3072, key_events, KEY_ACTION_TASK_PRIORITY, &key_action_task_handle);
+    } else {
+        ESP_LOGE(TAG, "Failed to subscribe to key events");
+        status_led_set_state(STATUS_LED_STATE_ERROR);
+    }
+
     create_task_or_fail(button_press_task, "Button Task", 2048, NULL, BUTTON_TASK_PRIORITY, &button_task_handle);
     create_task_or_fail(ir_decode_task, "IR Decoder Task", 4096, NULL, IR_DECODER_TASK_PRIORITY, &ir_decoder_task_handle);
     create_task_or_fail(speaker_driver_play_task, "Speaker", 4096, NULL, SPEAKER_TASK_PRIORITY, &speaker_task_handle);
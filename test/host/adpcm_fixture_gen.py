@@ -0,0 +1,43 @@
+# Writes the ADPCM fixture header for test_audio_mixer.c with the firmware's own encoder,
+# so the test fails as soon as audio_data_generator.py and audio_adpcm.c disagree.
+#   adpcm_fixture_gen.py <audio_data_generator.py> <output.h>
+import importlib.util
+import math
+import sys
+
+spec = importlib.util.spec_from_file_location("audio_data_generator", sys.argv[1])
+generator = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(generator)
+
+SAMPLE_RATE = 16000
+
+# Silence holds the step index at 0, full scale edges drive it to 88 and the predictor
+# into its limits, then silence walks it back down. Odd length, so the last byte carries
+# a padding nibble.
+def clamps_signal():
+    samples = [0] * 24
+    for i in range(96):
+        samples.append(32767 if (i // 8) % 2 == 0 else -32768)
+    samples += [0] * 81
+    return samples
+
+# Two tones at speech level, for the reconstruction error and the mixer render
+def tones_signal():
+    return [int(round(6000 * math.sin(2 * math.pi * 440 * n / SAMPLE_RATE) +
+                      3000 * math.sin(2 * math.pi * 1870 * n / SAMPLE_RATE)))
+            for n in range(1600)]
+
+def write_array(f, ctype, name, values):
+    f.write(f"static const {ctype} {name}[{len(values)}] = {{\n")
+    for i in range(0, len(values), 12):
+        f.write("    " + ", ".join(str(v) for v in values[i:i + 12]) + ",\n")
+    f.write("};\n\n")
+
+with open(sys.argv[2], "w") as f:
+    f.write("// Generated by adpcm_fixture_gen.py, do not edit\n\n#pragma once\n\n#include <stdint.h>\n\n")
+    for name, samples in (("clamps", clamps_signal()), ("tones", tones_signal())):
+        decoded = []
+        data = generator.to_ima_adpcm(samples, decoded)
+        write_array(f, "int16_t", f"s_{name}_input", samples)
+        write_array(f, "uint8_t", f"s_{name}_adpcm", data)
+        write_array(f, "int16_t", f"s_{name}_decoded", decoded)
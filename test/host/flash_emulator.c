@@ -0,0 +1,107 @@
+// flash_emulator.c
+
+#include "flash_emulator.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void _flash_emulator_io(flash_emulator_t* emu, size_t offset, void* data, size_t len, bool write) {
+    fseek(emu->file, (long)offset, SEEK_SET);
+    size_t done = write ? fwrite(data, 1, len, emu->file) : fread(data, 1, len, emu->file);
+    if (done != len) {
+        fprintf(stderr, "flash emulator I/O failed at 0x%zx\n", offset);
+        abort();
+    }
+}
+
+static esp_err_t _flash_emulator_read(void* ctx, size_t offset, void* dst, size_t len) {
+    flash_emulator_t* emu = (flash_emulator_t*)ctx;
+    if (offset + len > emu->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    emu->reads++;
+    _flash_emulator_io(emu, offset, dst, len, false);
+    return ESP_OK;
+}
+
+static esp_err_t _flash_emulator_write(void* ctx, size_t offset, const void* src, size_t len) {
+    flash_emulator_t* emu = (flash_emulator_t*)ctx;
+    if (offset + len > emu->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (emu->write_budget != FLASH_EMULATOR_UNLIMITED && (long)len > emu->write_budget) {
+        len = (size_t)emu->write_budget;
+        ret = ESP_FAIL;
+    }
+    if (emu->write_budget != FLASH_EMULATOR_UNLIMITED) {
+        emu->write_budget -= (long)len;
+    }
+
+    uint8_t cells[DHT11_STORE_SECTOR_SIZE];
+    const uint8_t* bytes = (const uint8_t*)src;
+    for (size_t done = 0; done < len;) {
+        size_t chunk = len - done < sizeof(cells) ? len - done : sizeof(cells);
+        _flash_emulator_io(emu, offset + done, cells, chunk, false);
+        for (size_t i = 0; i < chunk; i++) {
+            cells[i] &= bytes[done + i];
+        }
+        _flash_emulator_io(emu, offset + done, cells, chunk, true);
+        done += chunk;
+    }
+    return ret;
+}
+
+static esp_err_t _flash_emulator_erase_sector(void* ctx, size_t offset) {
+    flash_emulator_t* emu = (flash_emulator_t*)ctx;
+    if (offset % DHT11_STORE_SECTOR_SIZE != 0 || offset >= emu->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (emu->write_budget == 0) {
+        return ESP_FAIL;
+    }
+
+    uint8_t erased[DHT11_STORE_SECTOR_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    _flash_emulator_io(emu, offset, erased, sizeof(erased), true);
+    emu->erases[offset / DHT11_STORE_SECTOR_SIZE]++;
+    return ESP_OK;
+}
+
+void flash_emulator_open(flash_emulator_t* emu, size_t size, dht11_store_flash_t* flash) {
+    memset(emu, 0, sizeof(*emu));
+    emu->file         = tmpfile();
+    emu->size         = size;
+    emu->write_budget = FLASH_EMULATOR_UNLIMITED;
+    if (emu->file == NULL || size > FLASH_EMULATOR_MAX_SECTORS * DHT11_STORE_SECTOR_SIZE) {
+        fprintf(stderr, "flash emulator setup failed\n");
+        abort();
+    }
+
+    // Fresh parts ship erased
+    for (size_t offset = 0; offset < size; offset += DHT11_STORE_SECTOR_SIZE) {
+        _flash_emulator_erase_sector(emu, offset);
+        emu->erases[offset / DHT11_STORE_SECTOR_SIZE] = 0;
+    }
+
+    flash->read         = _flash_emulator_read;
+    flash->write        = _flash_emulator_write;
+    flash->erase_sector = _flash_emulator_erase_sector;
+    flash->ctx          = emu;
+    flash->size         = size;
+}
+
+void flash_emulator_close(flash_emulator_t* emu) {
+    fclose(emu->file);
+    emu->file = NULL;
+}
+
+void flash_emulator_poke(flash_emulator_t* emu, size_t offset, uint8_t value) {
+    _flash_emulator_io(emu, offset, &value, 1, true);
+}
+
+uint8_t flash_emulator_peek(flash_emulator_t* emu, size_t offset) {
+    uint8_t value;
+    _flash_emulator_io(emu, offset, &value, 1, false);
+    return value;
+}
@@ -0,0 +1,28 @@
+// flash_emulator.h
+
+#pragma once
+
+#include "dht11_store.h"
+#include <stdio.h>
+
+#define FLASH_EMULATOR_MAX_SECTORS 32
+
+// NOR flash in a temporary file: erase sets a sector to 0xFF and a write can only clear
+// bits. A write budget emulates a power cut, the write that exhausts it is torn and every
+// later write fails until the budget is lifted.
+typedef struct {
+    FILE* file;
+    size_t size;
+    long write_budget;
+    uint32_t reads;
+    uint32_t erases[FLASH_EMULATOR_MAX_SECTORS];
+} flash_emulator_t;
+
+#define FLASH_EMULATOR_UNLIMITED -1
+
+void flash_emulator_open(flash_emulator_t* emu, size_t size, dht11_store_flash_t* flash);
+void flash_emulator_close(flash_emulator_t* emu);
+
+// Overwrites bytes directly, bypassing NOR semantics, to corrupt what is already stored
+void flash_emulator_poke(flash_emulator_t* emu, size_t offset, uint8_t value);
+uint8_t flash_emulator_peek(flash_emulator_t* emu, size_t offset);
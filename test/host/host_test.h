@@ -0,0 +1,37 @@
+// host_test.h
+
+// Minimal check macros for the host tests, a failed check is reported and the test
+// carries on so one run shows every failure
+#pragma once
+
+#include <stdio.h>
+
+static int s_host_test_failures = 0;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            s_host_test_failures++;                                                  \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                             \
+    do {                                                                                       \
+        long long _a = (long long)(actual);                                                    \
+        long long _e = (long long)(expected);                                                  \
+        if (_a != _e) {                                                                        \
+            fprintf(stderr, "%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #actual, \
+                    _a, _e);                                                                   \
+            s_host_test_failures++;                                                            \
+        }                                                                                      \
+    } while (0)
+
+#define RUN_TEST(fn)                                                               \
+    do {                                                                           \
+        int _before = s_host_test_failures;                                        \
+        fn();                                                                      \
+        printf("%s %s\n", _before == s_host_test_failures ? "PASS" : "FAIL", #fn); \
+    } while (0)
+
+#define HOST_TEST_EXIT() (s_host_test_failures == 0 ? 0 : 1)
@@ -0,0 +1,6 @@
+// i2c_master.h
+
+// Host stand-in for the ESP-IDF header, tests replace the i2cbus functions themselves
+#pragma once
+
+typedef struct i2c_master_dev_t* i2c_master_dev_handle_t;
@@ -0,0 +1,16 @@
+// FreeRTOS.h
+
+// Host stand-in for the FreeRTOS header, only what the tested code touches
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdTRUE                 1
+#define pdFALSE                0
+#define portMAX_DELAY          ((TickType_t)0xFFFFFFFF)
+// The firmware runs at the ESP-IDF default tick rate, where short delays round to 0 ticks
+#define configTICK_RATE_HZ     100
+#define pdMS_TO_TICKS(ms)      ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
@@ -0,0 +1,15 @@
+// task.h
+
+// Host stand-in for the FreeRTOS header, delays advance the simulated clock
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "host_clock.h"
+
+// A delay ends on the n-th tick interrupt from now, the first of which may be due at
+// once, so only n - 1 whole tick periods are certain to pass
+static inline void vTaskDelay(TickType_t ticks) {
+    if (ticks > 0) {
+        host_clock_ns += (uint64_t)(ticks - 1) * (1000000000 / configTICK_RATE_HZ);
+    }
+}
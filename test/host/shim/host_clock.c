@@ -0,0 +1,5 @@
+// host_clock.c
+
+#include "host_clock.h"
+
+uint64_t host_clock_ns = 0;
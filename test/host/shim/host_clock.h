@@ -0,0 +1,9 @@
+// host_clock.h
+
+// Simulated time for the host tests. Delays advance it instead of sleeping, so fakes of
+// timing sensitive hardware can check what the code under test waited for.
+#pragma once
+
+#include <stdint.h>
+
+extern uint64_t host_clock_ns;
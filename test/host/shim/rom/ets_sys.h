@@ -0,0 +1,11 @@
+// ets_sys.h
+
+// Host stand-in for the ESP-IDF header, busy waits advance the simulated clock
+#pragma once
+
+#include "host_clock.h"
+#include <stdint.h>
+
+static inline void esp_rom_delay_us(uint32_t us) {
+    host_clock_ns += (uint64_t)us * 1000;
+}
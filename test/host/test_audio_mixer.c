@@ -0,0 +1,412 @@
+// test_audio_mixer.c
+
+#include "adpcm_fixture.h"
+#include "audio_mixer.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAMPLE_RATE_HZ 16000
+#define BLOCK_SAMPLES  64
+
+// The mixer carries each sample's rounding error into the next, so a sample may land one
+// step either side of the plain rounding the reference does
+#define REFERENCE_TOLERANCE 1
+
+#define LEN(array) (sizeof(array) / sizeof(array[0]))
+
+// Floating point model of one voice, kept apart from the mixer's fixed point state
+typedef struct {
+    const audio_clip_t* clip;
+    size_t pos;
+    double phase;
+} reference_voice_t;
+
+static double reference_voice_next(reference_voice_t* v) {
+    const audio_clip_t* clip = v->clip;
+    if (clip == NULL || v->pos >= clip->samples) {
+        return 0.0;
+    }
+
+    double sample;
+    if (clip->format == AUDIO_CLIP_TONE) {
+        sample    = v->phase < 0.5 ? AUDIO_TONE_AMPLITUDE : -AUDIO_TONE_AMPLITUDE;
+        v->phase  = fmod(v->phase + (double)clip->tone_hz / SAMPLE_RATE_HZ, 1.0);
+    } else {
+        sample = (double)clip->data[v->pos] - AUDIO_SAMPLE_MIDPOINT;
+    }
+    v->pos++;
+    return sample * clip->gain / AUDIO_GAIN_UNITY;
+}
+
+static int reference_render(reference_voice_t* voices, size_t count, uint16_t volume) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += reference_voice_next(&voices[i]);
+    }
+
+    double level = floor(sum * volume / AUDIO_GAIN_UNITY + 0.5);
+    if (level > 127) {
+        level = 127;
+    } else if (level < -128) {
+        level = -128;
+    }
+    return (int)level + AUDIO_SAMPLE_MIDPOINT;
+}
+
+// Renders in DMA sized blocks, the way the speaker task calls the mixer
+static void render_blocks(audio_mixer_t* mixer, uint8_t* out, size_t samples, size_t block) {
+    for (size_t off = 0; off < samples; off += block) {
+        size_t n = samples - off < block ? samples - off : block;
+        audio_mixer_render(mixer, out + off, n);
+    }
+}
+
+// Largest distance from the reference over the whole render
+static int compare_reference(const uint8_t* out, size_t samples, reference_voice_t* voices, size_t count, uint16_t volume) {
+    int worst = 0;
+    for (size_t i = 0; i < samples; i++) {
+        int diff = abs((int)out[i] - reference_render(voices, count, volume));
+        if (diff > worst) {
+            worst = diff;
+        }
+    }
+    return worst;
+}
+
+static void fill_sine(uint8_t* data, size_t samples, double amplitude, double step) {
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = (uint8_t)lround(AUDIO_SAMPLE_MIDPOINT + amplitude * sin(i * step));
+    }
+}
+
+static void test_two_voices(void) {
+    static uint8_t pcm[3000];
+    fill_sine(pcm, sizeof(pcm), 60.0, 0.07);
+
+    audio_clip_t recorded = {
+        .format   = AUDIO_CLIP_PCM_U8,
+        .data     = pcm,
+        .samples  = sizeof(pcm),
+        .gain     = AUDIO_GAIN_UNITY,
+        .priority = 1,
+    };
+    audio_clip_t tone = {
+        .format   = AUDIO_CLIP_TONE,
+        .samples  = 1800,
+        .tone_hz  = 1000,
+        .gain     = AUDIO_GAIN_UNITY / 2,
+        .priority = 0,
+    };
+
+    audio_mixer_t mixer;
+    audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+    CHECK(!audio_mixer_active(&mixer));
+
+    audio_mixer_start(&mixer, audio_mixer_pick_voice(&mixer, recorded.priority), &recorded);
+    audio_mixer_start(&mixer, audio_mixer_pick_voice(&mixer, tone.priority), &tone);
+
+    // Both voices busy: an equal priority waits, a higher one takes the tone's voice
+    CHECK_EQ(audio_mixer_pick_voice(&mixer, 0), -1);
+    CHECK_EQ(audio_mixer_pick_voice(&mixer, 1), 1);
+
+    static uint8_t out[3200];
+    render_blocks(&mixer, out, sizeof(out), BLOCK_SAMPLES);
+
+    reference_voice_t voices[] = {{.clip = &recorded}, {.clip = &tone}};
+    CHECK(compare_reference(out, sizeof(out), voices, 2, AUDIO_GAIN_UNITY) <= REFERENCE_TOLERANCE);
+
+    // Both clips ended inside the render, the tail is silence and the voices are free
+    CHECK(!audio_mixer_active(&mixer));
+    CHECK_EQ(out[sizeof(out) - 1], AUDIO_SAMPLE_MIDPOINT);
+}
+
+static void test_saturation(void) {
+    static uint8_t loud[256];
+    for (size_t i = 0; i < sizeof(loud); i++) {
+        loud[i] = i < 128 ? 0xFF : 0x00;
+    }
+
+    audio_clip_t clip = {
+        .format  = AUDIO_CLIP_PCM_U8,
+        .data    = loud,
+        .samples = sizeof(loud),
+        .gain    = AUDIO_GAIN_UNITY,
+    };
+
+    audio_mixer_t mixer;
+    audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+    audio_mixer_start(&mixer, 0, &clip);
+    audio_mixer_start(&mixer, 1, &clip);
+
+    // Two full scale voices sum to twice the range and clip at the rails instead of
+    // wrapping around to the other one
+    uint8_t out[256];
+    render_blocks(&mixer, out, sizeof(out), BLOCK_SAMPLES);
+
+    int wrapped = 0;
+    for (size_t i = 0; i < sizeof(out); i++) {
+        if (out[i] != (i < 128 ? 0xFF : 0x00)) {
+            wrapped++;
+        }
+    }
+    CHECK_EQ(wrapped, 0);
+}
+
+static void test_gain(void) {
+    static uint8_t pcm[1000];
+    fill_sine(pcm, sizeof(pcm), 120.0, 0.031);
+
+    audio_clip_t quiet = {
+        .format  = AUDIO_CLIP_PCM_U8,
+        .data    = pcm,
+        .samples = sizeof(pcm),
+        .gain    = AUDIO_GAIN_UNITY / 2,
+    };
+    audio_clip_t boosted = quiet;
+    boosted.gain         = AUDIO_GAIN_UNITY * 3 / 2;
+
+    static const uint16_t volumes[] = {0, AUDIO_GAIN_UNITY / 4, AUDIO_GAIN_UNITY / 2, AUDIO_GAIN_UNITY};
+
+    for (size_t v = 0; v < sizeof(volumes) / sizeof(volumes[0]); v++) {
+        audio_mixer_t mixer;
+        audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+        audio_mixer_set_volume(&mixer, volumes[v]);
+        audio_mixer_start(&mixer, 0, &quiet);
+        audio_mixer_start(&mixer, 1, &boosted);
+
+        uint8_t out[sizeof(pcm)];
+        render_blocks(&mixer, out, sizeof(out), BLOCK_SAMPLES);
+
+        reference_voice_t voices[] = {{.clip = &quiet}, {.clip = &boosted}};
+        CHECK(compare_reference(out, sizeof(out), voices, 2, volumes[v]) <= REFERENCE_TOLERANCE);
+    }
+
+    // Zero volume is silence whatever the voices play
+    audio_mixer_t mixer;
+    audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+    audio_mixer_set_volume(&mixer, 0);
+    audio_mixer_start(&mixer, 0, &boosted);
+
+    uint8_t out[BLOCK_SAMPLES];
+    audio_mixer_render(&mixer, out, sizeof(out));
+    for (size_t i = 0; i < sizeof(out); i++) {
+        CHECK_EQ(out[i], AUDIO_SAMPLE_MIDPOINT);
+    }
+}
+
+static void test_error_feedback(void) {
+    // One step above the midpoint at a quarter gain asks for a quarter step, which plain
+    // truncation would turn into silence
+    static uint8_t level[4000];
+    memset(level, AUDIO_SAMPLE_MIDPOINT + 1, sizeof(level));
+
+    audio_clip_t clip = {
+        .format  = AUDIO_CLIP_PCM_U8,
+        .data    = level,
+        .samples = sizeof(level),
+        .gain    = AUDIO_GAIN_UNITY / 4,
+    };
+
+    audio_mixer_t mixer;
+    audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+    audio_mixer_start(&mixer, 0, &clip);
+
+    static uint8_t out[sizeof(level)];
+    render_blocks(&mixer, out, sizeof(out), BLOCK_SAMPLES);
+
+    long sum = 0;
+    int outside = 0;
+    for (size_t i = 0; i < sizeof(out); i++) {
+        sum += out[i] - AUDIO_SAMPLE_MIDPOINT;
+        if (out[i] != AUDIO_SAMPLE_MIDPOINT && out[i] != AUDIO_SAMPLE_MIDPOINT + 1) {
+            outside++;
+        }
+    }
+    CHECK_EQ(outside, 0);
+    CHECK_EQ(sum, (long)sizeof(out) / 4);
+
+    // Whole steps pass through untouched, and the silence after a clip is exact
+    static uint8_t pcm[1000];
+    fill_sine(pcm, sizeof(pcm), 100.0, 0.05);
+    clip.data    = pcm;
+    clip.samples = sizeof(pcm);
+    clip.gain    = AUDIO_GAIN_UNITY;
+
+    uint8_t played[sizeof(pcm) + BLOCK_SAMPLES];
+    audio_mixer_start(&mixer, 0, &clip);
+    render_blocks(&mixer, played, sizeof(played), BLOCK_SAMPLES);
+    CHECK(memcmp(played, pcm, sizeof(pcm)) == 0);
+    for (size_t i = sizeof(pcm); i < sizeof(played); i++) {
+        CHECK_EQ(played[i], AUDIO_SAMPLE_MIDPOINT);
+    }
+}
+
+static void test_tone_phase(void) {
+    audio_clip_t tone = {
+        .format  = AUDIO_CLIP_TONE,
+        .samples = SAMPLE_RATE_HZ,
+        .tone_hz = 440,
+        .gain    = AUDIO_GAIN_UNITY,
+    };
+
+    // One second in DMA blocks and in odd sized ones, the phase carries across calls
+    static uint8_t blocks[SAMPLE_RATE_HZ];
+    static uint8_t odd[SAMPLE_RATE_HZ];
+
+    audio_mixer_t mixer;
+    audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+    audio_mixer_start(&mixer, 0, &tone);
+    render_blocks(&mixer, blocks, sizeof(blocks), BLOCK_SAMPLES);
+
+    audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+    audio_mixer_start(&mixer, 0, &tone);
+    render_blocks(&mixer, odd, sizeof(odd), 37);
+    CHECK(memcmp(blocks, odd, sizeof(blocks)) == 0);
+
+    // Square wave edges land where the exact phase crosses each half cycle. The 32-bit
+    // phase step truncates, so a sample sitting right on an edge may go either way.
+    int misplaced = 0;
+    int edges     = 0;
+    for (size_t i = 0; i < sizeof(blocks); i++) {
+        double phase = fmod((double)i * tone.tone_hz / SAMPLE_RATE_HZ, 1.0);
+        bool high    = blocks[i] > AUDIO_SAMPLE_MIDPOINT;
+        bool on_edge = fabs(phase - 0.5) < 1e-6 || phase < 1e-6;
+        if (high != (phase < 0.5) && !on_edge) {
+            misplaced++;
+        }
+        if (i > 0 && (blocks[i] > AUDIO_SAMPLE_MIDPOINT) != (blocks[i - 1] > AUDIO_SAMPLE_MIDPOINT)) {
+            edges++;
+        }
+    }
+    CHECK_EQ(misplaced, 0);
+
+    // Two edges per cycle, less the one the first sample starts on
+    CHECK_EQ(edges, 2 * tone.tone_hz - 1);
+}
+
+// Step index clamps hit while decoding, the table would have taken it below 0 or above 88
+typedef struct {
+    size_t mismatches;
+    size_t bottom_clamps;
+    size_t top_clamps;
+} adpcm_decode_result_t;
+
+// Decodes a fixture stream low nibble first, the way the mixer reads a clip
+static adpcm_decode_result_t decode_stream(const uint8_t* data, size_t samples, const int16_t* expected) {
+    adpcm_decode_result_t result = {0};
+    audio_adpcm_state_t state;
+    audio_adpcm_init(&state);
+
+    for (size_t i = 0; i < samples; i++) {
+        uint8_t nibble = (i & 1) ? data[i >> 1] >> 4 : data[i >> 1] & 0x0F;
+        uint8_t index  = state.step_index;
+
+        if (audio_adpcm_decode(&state, nibble) != expected[i]) {
+            result.mismatches++;
+        }
+        if (index == 0 && (nibble & 7) < 4) {
+            result.bottom_clamps++;
+        }
+        if (index == 88 && (nibble & 7) >= 4) {
+            result.top_clamps++;
+        }
+    }
+    return result;
+}
+
+// The step index starts at 0, so the first samples are spent ramping it up
+#define ADPCM_SETTLE_SAMPLES 32
+
+static void test_adpcm_matches_encoder(void) {
+    // Full scale edges push the step index into its top clamp, the silence around them
+    // holds it in the bottom one, and the predictor saturates at both rails on the way
+    adpcm_decode_result_t clamps = decode_stream(s_clamps_adpcm, LEN(s_clamps_input), s_clamps_decoded);
+    CHECK_EQ(clamps.mismatches, 0);
+    CHECK(clamps.bottom_clamps > 0);
+    CHECK(clamps.top_clamps > 0);
+
+    bool top    = false;
+    bool bottom = false;
+    for (size_t i = 0; i < LEN(s_clamps_decoded); i++) {
+        top |= s_clamps_decoded[i] == INT16_MAX;
+        bottom |= s_clamps_decoded[i] == INT16_MIN;
+    }
+    CHECK(top && bottom);
+
+    // An odd sample count leaves a zero padding nibble in the high half of the last byte
+    CHECK_EQ(LEN(s_clamps_input) % 2, 1);
+    CHECK_EQ(LEN(s_clamps_adpcm), (LEN(s_clamps_input) + 1) / 2);
+    CHECK_EQ(s_clamps_adpcm[LEN(s_clamps_adpcm) - 1] >> 4, 0);
+
+    adpcm_decode_result_t tones = decode_stream(s_tones_adpcm, LEN(s_tones_input), s_tones_decoded);
+    CHECK_EQ(tones.mismatches, 0);
+
+    // Reconstruction error of speech level tones once the step size has settled
+    double signal = 0.0;
+    double noise  = 0.0;
+    for (size_t i = ADPCM_SETTLE_SAMPLES; i < LEN(s_tones_input); i++) {
+        double error = (double)s_tones_decoded[i] - s_tones_input[i];
+        signal += (double)s_tones_input[i] * s_tones_input[i];
+        noise += error * error;
+    }
+    double snr_db = 10.0 * log10(signal / noise);
+    printf("ADPCM reconstruction SNR %.1f dB\n", snr_db);
+    CHECK(snr_db >= 25.0);
+}
+
+static void test_adpcm_clip(void) {
+    audio_clip_t clip = {
+        .format  = AUDIO_CLIP_IMA_ADPCM,
+        .data    = s_tones_adpcm,
+        .samples = LEN(s_tones_input),
+        .gain    = AUDIO_GAIN_UNITY,
+    };
+
+    audio_mixer_t mixer;
+    audio_mixer_init(&mixer, SAMPLE_RATE_HZ);
+    audio_mixer_start(&mixer, 0, &clip);
+
+    static uint8_t out[LEN(s_tones_input)];
+    render_blocks(&mixer, out, sizeof(out), BLOCK_SAMPLES);
+
+    // The mixer keeps the decoder's 16 bits until the final rounding to 8
+    int worst = 0;
+    long drift = 0;
+    for (size_t i = 0; i < sizeof(out); i++) {
+        int expected = (int)floor(s_tones_decoded[i] / 256.0 + 0.5) + AUDIO_SAMPLE_MIDPOINT;
+        int diff     = out[i] - expected;
+        drift += diff;
+        if (abs(diff) > worst) {
+            worst = abs(diff);
+        }
+    }
+    CHECK(worst <= REFERENCE_TOLERANCE);
+    CHECK(labs(drift) <= LEN(s_tones_input) / 100);
+
+    // The padding nibble of an odd length clip is never played
+    clip.data    = s_clamps_adpcm;
+    clip.samples = LEN(s_clamps_input);
+    audio_mixer_start(&mixer, 0, &clip);
+
+    uint8_t clamps[LEN(s_clamps_input) + 1];
+    render_blocks(&mixer, clamps, sizeof(clamps), BLOCK_SAMPLES);
+    CHECK(!audio_mixer_active(&mixer));
+    CHECK_EQ(clamps[LEN(s_clamps_input)], AUDIO_SAMPLE_MIDPOINT);
+
+    // A saturated predictor reaches the DAC rails without wrapping
+    CHECK(memchr(clamps, 0xFF, sizeof(clamps)) != NULL);
+    CHECK(memchr(clamps, 0x00, sizeof(clamps)) != NULL);
+}
+
+int main(void) {
+    RUN_TEST(test_two_voices);
+    RUN_TEST(test_saturation);
+    RUN_TEST(test_gain);
+    RUN_TEST(test_error_feedback);
+    RUN_TEST(test_tone_phase);
+    RUN_TEST(test_adpcm_matches_encoder);
+    RUN_TEST(test_adpcm_clip);
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,166 @@
+// test_dht11_codec.c
+
+#include "dht11_codec.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERIES_LEN 4096
+
+static uint32_t s_rng = 0x2545F491;
+
+static uint32_t _rand(void) {
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static int32_t _rand_range(int32_t lo, int32_t hi) {
+    return lo + (int32_t)(_rand() % (uint32_t)(hi - lo + 1));
+}
+
+// Values are generated already quantized so a round trip must reproduce them exactly
+typedef struct {
+    uint32_t timestamp;
+    int32_t temperature_centi;
+    int32_t humidity_deci;
+} sample_t;
+
+static sample_t s_series[SERIES_LEN];
+
+static dht11_reading_t _to_reading(const sample_t* sample) {
+    dht11_reading_t reading = {
+        .temperature = sample->temperature_centi / 100.0f,
+        .humidity    = sample->humidity_deci / 10.0f,
+        .timestamp   = (time_t)sample->timestamp,
+    };
+    return reading;
+}
+
+// Encodes the series into buffers of `capacity` bytes, decodes every buffer on its own and
+// compares, returns the encoded size
+static size_t _round_trip(const sample_t* series, size_t len, size_t capacity) {
+    uint8_t* buf = malloc(capacity);
+    size_t total = 0;
+    size_t next  = 0;
+
+    while (next < len) {
+        dht11_codec_encoder_t enc;
+        dht11_codec_encoder_init(&enc, buf, capacity);
+
+        size_t first = next;
+        while (next < len) {
+            dht11_reading_t reading = _to_reading(&series[next]);
+            if (!dht11_codec_encode(&enc, &reading)) {
+                break;
+            }
+            next++;
+        }
+        CHECK(enc.len <= capacity);
+        if (next == first) {
+            CHECK(capacity < DHT11_CODEC_MAX_SAMPLE_SIZE);
+            break;
+        }
+
+        dht11_codec_decoder_t dec;
+        dht11_reading_t out;
+        dht11_codec_decoder_init(&dec, buf, enc.len, enc.count);
+        for (size_t i = first; i < next; i++) {
+            CHECK(dht11_codec_decode(&dec, &out));
+            CHECK_EQ((uint32_t)out.timestamp, series[i].timestamp);
+            CHECK_EQ(lroundf(out.temperature * 100.0f), series[i].temperature_centi);
+            CHECK_EQ(lroundf(out.humidity * 10.0f), series[i].humidity_deci);
+        }
+        CHECK(!dht11_codec_decode(&dec, &out));
+        CHECK_EQ(dec.pos, enc.len);
+
+        // A truncated buffer stops decoding instead of reading past the end
+        if (enc.len > 1) {
+            dht11_codec_decoder_init(&dec, buf, enc.len - 1, enc.count);
+            uint32_t decoded = 0;
+            while (dht11_codec_decode(&dec, &out)) {
+                decoded++;
+            }
+            CHECK(decoded < enc.count);
+        }
+        total += enc.len;
+    }
+
+    free(buf);
+    return total;
+}
+
+static void test_fuzz_extreme_deltas(void) {
+    static const size_t capacities[] = {1, 14, 15, 16, 60, 256, 65536};
+
+    for (int round = 0; round < 200; round++) {
+        uint32_t timestamp = _rand();
+        for (size_t i = 0; i < SERIES_LEN; i++) {
+            // Mostly full-range jumps, sometimes the sensor's own steady one-minute pattern
+            if (_rand() % 4 == 0) {
+                timestamp += 60;
+            } else {
+                timestamp += _rand();
+            }
+            s_series[i].timestamp         = timestamp;
+            s_series[i].temperature_centi = _rand_range(-400000, 400000);
+            s_series[i].humidity_deci     = _rand_range(-10000, 10000);
+        }
+        size_t capacity = capacities[_rand() % (sizeof(capacities) / sizeof(capacities[0]))];
+        _round_trip(s_series, SERIES_LEN, capacity);
+    }
+}
+
+static void test_timestamp_wrap(void) {
+    // The codec keeps 32-bit timestamps, steps across the 2106 wrap must decode both ways,
+    // forward and back again after a clock correction
+    uint32_t timestamp = 0xFFFFFE00u;
+    for (size_t i = 0; i < 64; i++) {
+        timestamp += (i == 15) ? (uint32_t)-600 : 60;
+        s_series[i].timestamp         = timestamp;
+        s_series[i].temperature_centi = 7200;
+        s_series[i].humidity_deci     = 450;
+    }
+    CHECK(s_series[14].timestamp < s_series[0].timestamp);
+    CHECK(s_series[15].timestamp > s_series[14].timestamp);
+    CHECK(s_series[63].timestamp < s_series[0].timestamp);
+    _round_trip(s_series, 64, 60);
+    _round_trip(s_series, 64, 4096);
+}
+
+static void test_compression_ratio(void) {
+    // One reading a minute for a few days: the sensor resolves 0.1 C and 1 %RH, the task
+    // stores Fahrenheit, and the clock jitters by a second now and then
+    uint32_t timestamp = 1700000000;
+    for (size_t i = 0; i < SERIES_LEN; i++) {
+        double celsius  = 22.0 + 3.0 * sin(i * 2.0 * M_PI / 1440.0) + _rand_range(-1, 1) * 0.1;
+        double humidity = 45.0 + 8.0 * cos(i * 2.0 * M_PI / 1440.0) + _rand_range(-1, 1);
+        timestamp += 60 + ((_rand() % 16 == 0) ? 1 : 0);
+
+        s_series[i].timestamp         = timestamp;
+        s_series[i].temperature_centi = (int32_t)lround((round(celsius * 10.0) / 10.0 * 1.8 + 32.0) * 100.0);
+        s_series[i].humidity_deci     = (int32_t)lround(humidity) * 10;
+    }
+
+    // Store block payload size and a single large buffer
+    size_t block_bytes = _round_trip(s_series, SERIES_LEN, 60);
+    size_t flat_bytes  = _round_trip(s_series, SERIES_LEN, 65536);
+
+    double per_block = (double)block_bytes / SERIES_LEN;
+    double per_flat  = (double)flat_bytes / SERIES_LEN;
+    printf("raw %zu B/sample, 60 B blocks %.2f B/sample (%.1fx), one buffer %.2f B/sample (%.1fx)\n",
+           sizeof(dht11_reading_t), per_block, sizeof(dht11_reading_t) / per_block, per_flat,
+           sizeof(dht11_reading_t) / per_flat);
+
+    CHECK(per_flat < 4.0);
+    CHECK(per_block < 4.5);
+}
+
+int main(void) {
+    RUN_TEST(test_fuzz_extreme_deltas);
+    RUN_TEST(test_timestamp_wrap);
+    RUN_TEST(test_compression_ratio);
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,107 @@
+// test_dht11_decode.c
+
+#include "dht11_decode.h"
+#include "host_test.h"
+#include <string.h>
+
+// Edge ISR capture of a 45 %RH / 23.1 C frame: host release, sensor response, 40 bits
+// and the final release. Levels are the line level after each edge.
+static const dht11_edge_t s_frame[] = {
+    {    0, 1}, {   31, 0}, {  111, 1}, {  195, 0}, {  249, 1}, {  272, 0},
+    {  321, 1}, {  350, 0}, {  403, 1}, {  471, 0}, {  522, 1}, {  549, 0},
+    {  598, 1}, {  670, 0}, {  720, 1}, {  788, 0}, {  837, 1}, {  863, 0},
+    {  915, 1}, {  983, 0}, { 1033, 1}, { 1056, 0}, { 1109, 1}, { 1135, 0},
+    { 1184, 1}, { 1213, 0}, { 1266, 1}, { 1289, 0}, { 1339, 1}, { 1367, 0},
+    { 1421, 1}, { 1448, 0}, { 1497, 1}, { 1524, 0}, { 1577, 1}, { 1603, 0},
+    { 1652, 1}, { 1676, 0}, { 1725, 1}, { 1752, 0}, { 1807, 1}, { 1831, 0},
+    { 1882, 1}, { 1953, 0}, { 2003, 1}, { 2030, 0}, { 2079, 1}, { 2151, 0},
+    { 2202, 1}, { 2274, 0}, { 2329, 1}, { 2402, 0}, { 2452, 1}, { 2475, 0},
+    { 2528, 1}, { 2555, 0}, { 2609, 1}, { 2633, 0}, { 2684, 1}, { 2707, 0},
+    { 2760, 1}, { 2788, 0}, { 2837, 1}, { 2864, 0}, { 2913, 1}, { 2940, 0},
+    { 2990, 1}, { 3061, 0}, { 3115, 1}, { 3142, 0}, { 3194, 1}, { 3268, 0},
+    { 3319, 1}, { 3345, 0}, { 3398, 1}, { 3424, 0}, { 3475, 1}, { 3500, 0},
+    { 3550, 1}, { 3624, 0}, { 3674, 1}, { 3702, 0}, { 3757, 1}, { 3826, 0},
+    { 3876, 1},
+};
+
+#define FRAME_EDGES (sizeof(s_frame) / sizeof(s_frame[0]))
+
+// Index of the rising edge of data bit `bit`, after the release and response pulses
+#define BIT_RISE(bit) (4 + 2 * (bit))
+
+static const uint8_t s_expected[5] = {45, 0, 23, 1, 69};
+
+static void test_valid_frame(void) {
+    uint8_t data[5];
+    CHECK_EQ(dht11_decode_edges(s_frame, FRAME_EDGES, data), ESP_OK);
+    CHECK(memcmp(data, s_expected, sizeof(data)) == 0);
+}
+
+static void test_missed_leading_edges(void) {
+    // The ISR may attach after the release and miss the response, the frame is taken
+    // from the last 40 high pulses
+    uint8_t data[5];
+    CHECK_EQ(dht11_decode_edges(&s_frame[3], FRAME_EDGES - 3, data), ESP_OK);
+    CHECK(memcmp(data, s_expected, sizeof(data)) == 0);
+}
+
+static void test_bad_checksum(void) {
+    dht11_edge_t edges[FRAME_EDGES];
+    memcpy(edges, s_frame, sizeof(edges));
+
+    // Bit 31 is the low bit of the temperature decimal, shorten its 70 us pulse to 26 us
+    edges[BIT_RISE(31) + 1].time_us = edges[BIT_RISE(31)].time_us + 26;
+
+    uint8_t data[5];
+    CHECK_EQ(dht11_decode_edges(edges, FRAME_EDGES, data), ESP_ERR_INVALID_CRC);
+    CHECK_EQ(data[3], 0);
+}
+
+static void test_short_frame(void) {
+    uint8_t data[5];
+    CHECK_EQ(dht11_decode_edges(s_frame, 60, data), ESP_ERR_TIMEOUT);
+    CHECK_EQ(dht11_decode_edges(s_frame, 0, data), ESP_ERR_TIMEOUT);
+}
+
+static void test_long_pulse(void) {
+    dht11_edge_t edges[FRAME_EDGES];
+    memcpy(edges, s_frame, sizeof(edges));
+
+    // Stretch the one bit 2 to the limit and one microsecond past it
+    size_t rise = BIT_RISE(2);
+    uint32_t shift = edges[rise].time_us + DHT11_BIT_MAX_HIGH_US - edges[rise + 1].time_us;
+    for (size_t i = rise + 1; i < FRAME_EDGES; i++) {
+        edges[i].time_us += shift;
+    }
+
+    uint8_t data[5];
+    CHECK_EQ(dht11_decode_edges(edges, FRAME_EDGES, data), ESP_OK);
+
+    for (size_t i = rise + 1; i < FRAME_EDGES; i++) {
+        edges[i].time_us += 1;
+    }
+    CHECK_EQ(dht11_decode_edges(edges, FRAME_EDGES, data), ESP_ERR_TIMEOUT);
+}
+
+static void test_bit_threshold(void) {
+    dht11_edge_t edges[FRAME_EDGES];
+    memcpy(edges, s_frame, sizeof(edges));
+
+    // Bit 39 is a one, a pulse of exactly the threshold reads as a zero
+    uint8_t data[5];
+    edges[BIT_RISE(39) + 1].time_us = edges[BIT_RISE(39)].time_us + DHT11_BIT_ONE_THRESHOLD_US + 1;
+    CHECK_EQ(dht11_decode_edges(edges, FRAME_EDGES, data), ESP_OK);
+    edges[BIT_RISE(39) + 1].time_us = edges[BIT_RISE(39)].time_us + DHT11_BIT_ONE_THRESHOLD_US;
+    CHECK_EQ(dht11_decode_edges(edges, FRAME_EDGES, data), ESP_ERR_INVALID_CRC);
+    CHECK_EQ(data[4], 68);
+}
+
+int main(void) {
+    RUN_TEST(test_valid_frame);
+    RUN_TEST(test_missed_leading_edges);
+    RUN_TEST(test_bad_checksum);
+    RUN_TEST(test_short_frame);
+    RUN_TEST(test_long_pulse);
+    RUN_TEST(test_bit_threshold);
+    return HOST_TEST_EXIT();
+}
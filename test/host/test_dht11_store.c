@@ -0,0 +1,306 @@
+// test_dht11_store.c
+
+#include "dht11_store.h"
+#include "flash_emulator.h"
+#include "host_test.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BASE_TIME    1700000000
+#define INTERVAL_S   60
+#define MAX_READINGS 8192
+
+static dht11_reading_t s_out[MAX_READINGS];
+
+static dht11_reading_t _reading(uint32_t index) {
+    dht11_reading_t reading = {
+        .temperature = 68.0f + (float)(index % 23) * 0.18f,
+        .humidity    = 40.0f + (float)(index % 7),
+        .timestamp   = BASE_TIME + (time_t)index * INTERVAL_S,
+    };
+    return reading;
+}
+
+static uint32_t _index_of(const dht11_reading_t* reading) {
+    return (uint32_t)((reading->timestamp - BASE_TIME) / INTERVAL_S);
+}
+
+static size_t _read_all(const dht11_store_t* store) {
+    dht11_store_cursor_t cursor;
+    dht11_store_begin(store, &cursor);
+
+    size_t total = 0;
+    size_t count;
+    while ((count = dht11_store_read(store, &cursor, &s_out[total], 37)) > 0) {
+        total += count;
+    }
+    return total;
+}
+
+// Every reading read back matches what was appended, in order and without gaps
+static void _check_contiguous(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dht11_reading_t expected = _reading(_index_of(&s_out[0]) + (uint32_t)i);
+        CHECK_EQ(s_out[i].timestamp, expected.timestamp);
+        CHECK(s_out[i].temperature == lroundf(expected.temperature * 100.0f) / 100.0f);
+        CHECK(s_out[i].humidity == expected.humidity);
+        if (s_out[i].timestamp != expected.timestamp) {
+            return;
+        }
+    }
+}
+
+// Appends until the head reaches `seq`, returns the number of readings appended
+static uint32_t _fill_to_seq(dht11_store_t* store, uint32_t first, uint32_t seq) {
+    uint32_t index = first;
+    while (store->head_seq < seq) {
+        dht11_reading_t reading = _reading(index++);
+        CHECK_EQ(dht11_store_append(store, &reading), ESP_OK);
+    }
+    return index - first;
+}
+
+static void test_fresh_mount(void) {
+    flash_emulator_t emu;
+    dht11_store_flash_t flash;
+    dht11_store_t store;
+
+    flash_emulator_open(&emu, DHT11_STORE_SECTOR_SIZE, &flash);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_ERR_INVALID_SIZE);
+    flash_emulator_close(&emu);
+
+    flash_emulator_open(&emu, 4 * DHT11_STORE_SECTOR_SIZE, &flash);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+    CHECK_EQ(store.tail_seq, 1);
+    CHECK_EQ(store.head_seq, 1);
+    CHECK_EQ(store.head_slot, 0);
+    CHECK_EQ(_read_all(&store), 0);
+    flash_emulator_close(&emu);
+}
+
+static void test_append_and_remount(void) {
+    flash_emulator_t emu;
+    dht11_store_flash_t flash;
+    dht11_store_t store;
+    flash_emulator_open(&emu, 4 * DHT11_STORE_SECTOR_SIZE, &flash);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+
+    for (uint32_t i = 0; i < 500; i++) {
+        dht11_reading_t reading = _reading(i);
+        CHECK_EQ(dht11_store_append(&store, &reading), ESP_OK);
+    }
+    CHECK_EQ(_read_all(&store), 500);
+    _check_contiguous(500);
+
+    // A reset loses the open block and nothing else
+    uint32_t open_count = store.open.count;
+    uint32_t head_slot  = store.head_slot;
+    CHECK(open_count > 0);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+    CHECK_EQ(store.head_slot, head_slot);
+    CHECK_EQ(_read_all(&store), 500 - open_count);
+    _check_contiguous(500 - open_count);
+
+    flash_emulator_close(&emu);
+}
+
+static void test_wraparound(void) {
+    flash_emulator_t emu;
+    dht11_store_flash_t flash;
+    dht11_store_t store;
+    flash_emulator_open(&emu, 4 * DHT11_STORE_SECTOR_SIZE, &flash);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+
+    // Twice around the ring, the oldest sector is the one recycled
+    uint32_t appended = _fill_to_seq(&store, 0, 9);
+    CHECK_EQ(store.head_seq, 9);
+    CHECK_EQ(store.tail_seq, 6);
+    CHECK_EQ(store.head_sector, 0);
+
+    size_t count = _read_all(&store);
+    CHECK(count > 0 && count < appended);
+    CHECK_EQ(_index_of(&s_out[count - 1]), appended - 1);
+    _check_contiguous(count);
+
+    // Erases are spread evenly across the ring
+    for (uint32_t sector = 0; sector < 4; sector++) {
+        CHECK(emu.erases[sector] >= 2 && emu.erases[sector] <= 3);
+    }
+
+    time_t oldest = s_out[0].timestamp;
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+    CHECK_EQ(store.head_seq, 9);
+    CHECK_EQ(store.tail_seq, 6);
+    CHECK(_read_all(&store) > 0);
+    CHECK_EQ(s_out[0].timestamp, oldest);
+
+    flash_emulator_close(&emu);
+}
+
+static void test_torn_sector_header(void) {
+    flash_emulator_t emu;
+    dht11_store_flash_t flash;
+    dht11_store_t store;
+    flash_emulator_open(&emu, 4 * DHT11_STORE_SECTOR_SIZE, &flash);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+
+    uint32_t index = _fill_to_seq(&store, 0, 5);
+    while (store.head_slot < DHT11_STORE_BLOCKS_PER_SECTOR - 1) {
+        dht11_reading_t reading = _reading(index++);
+        CHECK_EQ(dht11_store_append(&store, &reading), ESP_OK);
+    }
+
+    // Power fails halfway through the header of the next sector, after sealing the last block
+    emu.write_budget = sizeof(dht11_store_block_t) + sizeof(dht11_store_header_t) / 2;
+    esp_err_t ret = ESP_OK;
+    uint32_t sealed_through = index;
+    while (ret == ESP_OK) {
+        sealed_through = index;
+        dht11_reading_t reading = _reading(index++);
+        ret = dht11_store_append(&store, &reading);
+    }
+    CHECK_EQ(ret, ESP_FAIL);
+    CHECK_EQ(flash_emulator_peek(&emu, 1 * DHT11_STORE_SECTOR_SIZE), DHT11_STORE_MAGIC & 0xFF);
+    CHECK_EQ(flash_emulator_peek(&emu, 1 * DHT11_STORE_SECTOR_SIZE + sizeof(dht11_store_header_t) - 1), 0xFF);
+
+    // The torn sector is not trusted, the full sector before it stays the newest one
+    emu.write_budget = FLASH_EMULATOR_UNLIMITED;
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+    CHECK_EQ(store.tail_seq, 3);
+    CHECK_EQ(store.head_seq, 6);
+    CHECK_EQ(store.head_sector, 1);
+    CHECK_EQ(store.head_slot, 0);
+
+    size_t count = _read_all(&store);
+    CHECK(count > 0);
+    CHECK_EQ(_index_of(&s_out[count - 1]), sealed_through - 1);
+    _check_contiguous(count);
+
+    for (uint32_t i = 0; i < 100; i++) {
+        dht11_reading_t reading = _reading(sealed_through + i);
+        CHECK_EQ(dht11_store_append(&store, &reading), ESP_OK);
+    }
+    count = _read_all(&store);
+    CHECK_EQ(_index_of(&s_out[count - 1]), sealed_through + 99);
+    _check_contiguous(count);
+
+    flash_emulator_close(&emu);
+}
+
+static void test_crc_mismatch(void) {
+    flash_emulator_t emu;
+    dht11_store_flash_t flash;
+    dht11_store_t store;
+    flash_emulator_open(&emu, 4 * DHT11_STORE_SECTOR_SIZE, &flash);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+    _fill_to_seq(&store, 0, 3);
+
+    size_t total = _read_all(&store);
+
+    // A flipped payload bit drops exactly that block
+    size_t block = sizeof(dht11_store_header_t) + 5 * sizeof(dht11_store_block_t);
+    uint8_t block_count = flash_emulator_peek(&emu, block + offsetof(dht11_store_block_t, count));
+    flash_emulator_poke(&emu, block + 7, flash_emulator_peek(&emu, block + 7) ^ 0x04);
+
+    size_t count = _read_all(&store);
+    CHECK_EQ(count, total - block_count);
+    size_t gaps = 0;
+    for (size_t i = 1; i < count; i++) {
+        uint32_t step = _index_of(&s_out[i]) - _index_of(&s_out[i - 1]);
+        if (step != 1) {
+            CHECK_EQ(step, block_count + 1);
+            gaps++;
+        }
+    }
+    CHECK_EQ(gaps, 1);
+
+    // A write torn inside a block leaves it unreadable and the next append goes after it
+    emu.write_budget = sizeof(dht11_store_block_t) / 2;
+    uint32_t index     = _index_of(&s_out[count - 1]) + 1;
+    uint32_t torn_slot = store.head_slot;
+    size_t sealed      = count - store.open.count;
+    esp_err_t ret = ESP_OK;
+    while (ret == ESP_OK) {
+        dht11_reading_t reading = _reading(index++);
+        ret = dht11_store_append(&store, &reading);
+    }
+    emu.write_budget = FLASH_EMULATOR_UNLIMITED;
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+    CHECK_EQ(store.head_slot, torn_slot + 1);
+    CHECK_EQ(_read_all(&store), sealed);
+
+    // A bad header CRC cuts the oldest sector off the log
+    flash_emulator_poke(&emu, offsetof(dht11_store_header_t, crc), 0x00);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+    CHECK_EQ(store.tail_seq, 2);
+    CHECK_EQ(store.head_seq, 3);
+    count = _read_all(&store);
+    CHECK(count > 0);
+    _check_contiguous(count);
+
+    flash_emulator_close(&emu);
+}
+
+static void test_seek_time(void) {
+    flash_emulator_t emu;
+    dht11_store_flash_t flash;
+    dht11_store_t store;
+    flash_emulator_open(&emu, 8 * DHT11_STORE_SECTOR_SIZE, &flash);
+    CHECK_EQ(dht11_store_mount(&store, &flash), ESP_OK);
+
+    // Wrapped, with a partly filled open block at the head
+    _fill_to_seq(&store, 0, 11);
+    size_t count = _read_all(&store);
+    CHECK_EQ(store.tail_seq, 4);
+    CHECK(store.open.count > 0);
+
+    dht11_reading_t* retained = malloc(count * sizeof(*retained));
+    memcpy(retained, s_out, count * sizeof(*retained));
+
+    dht11_store_cursor_t cursor;
+    dht11_reading_t found;
+    uint32_t max_reads = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        // An exact match and a time between two readings both land on reading i
+        for (int offset = 0; offset <= INTERVAL_S - 1; offset += INTERVAL_S - 1) {
+            time_t from = retained[i].timestamp - offset;
+            uint32_t reads_before = emu.reads;
+            CHECK_EQ(dht11_store_seek_time(&store, from, &cursor), ESP_OK);
+            if (emu.reads - reads_before > max_reads) {
+                max_reads = emu.reads - reads_before;
+            }
+            CHECK_EQ(dht11_store_read(&store, &cursor, &found, 1), 1);
+            CHECK_EQ(found.timestamp, retained[i].timestamp);
+            if (found.timestamp != retained[i].timestamp) {
+                free(retained);
+                flash_emulator_close(&emu);
+                return;
+            }
+        }
+    }
+
+    // Before the oldest reading starts at the tail, after the newest finds nothing
+    CHECK_EQ(dht11_store_seek_time(&store, 0, &cursor), ESP_OK);
+    CHECK_EQ(dht11_store_read(&store, &cursor, &found, 1), 1);
+    CHECK_EQ(found.timestamp, retained[0].timestamp);
+    CHECK_EQ(dht11_store_seek_time(&store, retained[count - 1].timestamp + 1, &cursor), ESP_OK);
+    CHECK_EQ(dht11_store_read(&store, &cursor, &found, 1), 0);
+
+    // Binary search over the 8 sectors, then one sector scanned block by block
+    CHECK(max_reads <= 4 + DHT11_STORE_BLOCKS_PER_SECTOR);
+
+    free(retained);
+    flash_emulator_close(&emu);
+}
+
+int main(void) {
+    RUN_TEST(test_fresh_mount);
+    RUN_TEST(test_append_and_remount);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_torn_sector_header);
+    RUN_TEST(test_crc_mismatch);
+    RUN_TEST(test_seek_time);
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,424 @@
+// test_history_export.c
+
+#include "history_export.h"
+#include "host_test.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BASE_TIME 1700000000
+
+// Sink that collects the chunks the writer flushes
+typedef struct {
+    char* data;
+    size_t len;
+    size_t capacity;
+    uint32_t chunks;
+    uint32_t short_chunks;
+    uint32_t unaligned_chunks;
+    uint32_t fail_after;
+} sink_t;
+
+static esp_err_t _sink_flush(void* ctx, const char* data, size_t len) {
+    sink_t* sink = (sink_t*)ctx;
+    CHECK(len > 0 && len <= STREAM_WRITER_BUF_SIZE);
+    if (sink->fail_after > 0 && sink->chunks == sink->fail_after) {
+        return ESP_FAIL;
+    }
+    if (sink->len + len + 1 > sink->capacity) {
+        sink->capacity = (sink->len + len + 1) * 2;
+        sink->data     = realloc(sink->data, sink->capacity);
+    }
+    if (len < STREAM_WRITER_BUF_SIZE) {
+        sink->short_chunks++;
+    }
+    if (data[len - 1] != '}') {
+        sink->unaligned_chunks++;
+    }
+    memcpy(sink->data + sink->len, data, len);
+    sink->len += len;
+    sink->data[sink->len] = '\0';
+    sink->chunks++;
+    return ESP_OK;
+}
+
+typedef struct {
+    const dht11_reading_t* readings;
+    uint32_t count;
+    uint32_t next;
+} source_t;
+
+static uint32_t _source_read(void* ctx, dht11_reading_t* buffer, uint32_t max) {
+    source_t* source = (source_t*)ctx;
+    uint32_t n       = 0;
+    while (n < max && source->next < source->count) {
+        buffer[n++] = source->readings[source->next++];
+    }
+    return n;
+}
+
+static dht11_reading_t* _make_readings(uint32_t count) {
+    dht11_reading_t* readings = malloc((count + 1) * sizeof(*readings));
+    for (uint32_t i = 0; i < count; i++) {
+        readings[i].temperature = -40.0f + (float)(i % 2000) * 0.09f;
+        readings[i].humidity    = (float)(i % 1001) / 10.0f;
+        readings[i].timestamp   = BASE_TIME + (time_t)i * 60;
+    }
+    return readings;
+}
+
+static esp_err_t _export(const dht11_reading_t* readings, uint32_t count, const history_query_t* query, sink_t* sink,
+                         uint32_t* num_records) {
+    source_t source = {readings, count, 0};
+    stream_writer_t writer;
+    memset(sink, 0, sizeof(*sink));
+    stream_writer_init(&writer, _sink_flush, sink);
+    return history_export(&writer, query, _source_read, &source, num_records);
+}
+
+// Strict recursive descent JSON parser. Records the numeric fields of the objects inside
+// the top-level "history" array so the values can be checked as well as the syntax.
+typedef struct {
+    const char* p;
+    int depth;
+    char key[32];
+    uint32_t records;
+    double* timestamps;
+    double* temperatures;
+    uint32_t max_records;
+} json_t;
+
+static bool _json_value(json_t* json);
+
+static void _json_ws(json_t* json) {
+    while (*json->p == ' ' || *json->p == '\n' || *json->p == '\r' || *json->p == '\t') {
+        json->p++;
+    }
+}
+
+static bool _json_string(json_t* json, char* out, size_t out_size) {
+    if (*json->p++ != '"') {
+        return false;
+    }
+    size_t len = 0;
+    while (*json->p != '"') {
+        if (*json->p == '\0' || (unsigned char)*json->p < 0x20) {
+            return false;
+        }
+        if (*json->p == '\\') {
+            json->p++;
+            if (strchr("\"\\/bfnrtu", *json->p) == NULL) {
+                return false;
+            }
+        }
+        if (out && len + 1 < out_size) {
+            out[len++] = *json->p;
+        }
+        json->p++;
+    }
+    if (out) {
+        out[len] = '\0';
+    }
+    json->p++;
+    return true;
+}
+
+static bool _json_number(json_t* json) {
+    const char* start = json->p;
+    if (*json->p == '-') {
+        json->p++;
+    }
+    if (*json->p == '0') {
+        json->p++;
+    } else if (isdigit((unsigned char)*json->p)) {
+        while (isdigit((unsigned char)*json->p)) {
+            json->p++;
+        }
+    } else {
+        return false;
+    }
+    if (*json->p == '.') {
+        json->p++;
+        if (!isdigit((unsigned char)*json->p)) {
+            return false;
+        }
+        while (isdigit((unsigned char)*json->p)) {
+            json->p++;
+        }
+    }
+    if (*json->p == 'e' || *json->p == 'E') {
+        json->p++;
+        if (*json->p == '+' || *json->p == '-') {
+            json->p++;
+        }
+        if (!isdigit((unsigned char)*json->p)) {
+            return false;
+        }
+        while (isdigit((unsigned char)*json->p)) {
+            json->p++;
+        }
+    }
+
+    // depth 3 is a record object inside the history array inside the root object
+    if (json->depth == 3 && json->records > 0 && json->records <= json->max_records) {
+        double value = strtod(start, NULL);
+        if (strcmp(json->key, "timestamp") == 0) {
+            json->timestamps[json->records - 1] = value;
+        } else if (strcmp(json->key, "temperature") == 0) {
+            json->temperatures[json->records - 1] = value;
+        }
+    }
+    return true;
+}
+
+static bool _json_object(json_t* json) {
+    json->p++;
+    json->depth++;
+    if (json->depth == 3) {
+        json->records++;
+    }
+    _json_ws(json);
+    if (*json->p == '}') {
+        json->p++;
+        json->depth--;
+        return true;
+    }
+    while (true) {
+        char key[sizeof(json->key)];
+        _json_ws(json);
+        if (!_json_string(json, key, sizeof(key))) {
+            return false;
+        }
+        _json_ws(json);
+        if (*json->p++ != ':') {
+            return false;
+        }
+        memcpy(json->key, key, sizeof(key));
+        if (!_json_value(json)) {
+            return false;
+        }
+        _json_ws(json);
+        if (*json->p == ',') {
+            json->p++;
+            continue;
+        }
+        if (*json->p++ != '}') {
+            return false;
+        }
+        json->depth--;
+        return true;
+    }
+}
+
+static bool _json_array(json_t* json) {
+    json->p++;
+    json->depth++;
+    _json_ws(json);
+    if (*json->p == ']') {
+        json->p++;
+        json->depth--;
+        return true;
+    }
+    while (true) {
+        if (!_json_value(json)) {
+            return false;
+        }
+        _json_ws(json);
+        if (*json->p == ',') {
+            json->p++;
+            continue;
+        }
+        if (*json->p++ != ']') {
+            return false;
+        }
+        json->depth--;
+        return true;
+    }
+}
+
+static bool _json_value(json_t* json) {
+    _json_ws(json);
+    switch (*json->p) {
+        case '{':
+            return _json_object(json);
+        case '[':
+            return _json_array(json);
+        case '"':
+            return _json_string(json, NULL, 0);
+        case 't':
+            return strncmp(json->p, "true", 4) == 0 && (json->p += 4);
+        case 'f':
+            return strncmp(json->p, "false", 5) == 0 && (json->p += 5);
+        case 'n':
+            return strncmp(json->p, "null", 4) == 0 && (json->p += 4);
+        default:
+            return _json_number(json);
+    }
+}
+
+static bool _json_parse(json_t* json, const char* text, uint32_t max_records) {
+    memset(json, 0, sizeof(*json));
+    json->p            = text;
+    json->max_records  = max_records;
+    json->timestamps   = calloc(max_records + 1, sizeof(double));
+    json->temperatures = calloc(max_records + 1, sizeof(double));
+    bool ok = _json_value(json);
+    _json_ws(json);
+    return ok && *json->p == '\0';
+}
+
+static void _json_free(json_t* json) {
+    free(json->timestamps);
+    free(json->temperatures);
+}
+
+static void test_json_parser(void) {
+    // The checker itself has to reject what a browser would
+    static const char* bad[] = {
+        "", "{", "{\"history\":[}", "{\"history\":[{},]}", "{\"a\":01}", "{\"a\":1.}", "{\"a\":nan}",
+        "{\"a\":1}}", "{\"a\" 1}", "[1,2",
+    };
+    json_t json;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        CHECK(!_json_parse(&json, bad[i], 0));
+        _json_free(&json);
+    }
+    CHECK(_json_parse(&json, "{\"history\":[{\"timestamp\":5,\"x\":[true,null,\"s\\\"\"]}],\"n\":-1.5e3}", 1));
+    CHECK_EQ(json.records, 1);
+    CHECK_EQ(json.timestamps[0], 5);
+    _json_free(&json);
+}
+
+static void _check_json_samples(uint32_t count) {
+    dht11_reading_t* readings = _make_readings(count);
+    history_query_t query     = {.from = 0, .to = INT32_MAX, .step = 0, .format = HISTORY_FORMAT_JSON};
+    sink_t sink;
+    uint32_t num_records = 0;
+
+    CHECK_EQ(_export(readings, count, &query, &sink, &num_records), ESP_OK);
+    CHECK_EQ(num_records, count);
+
+    json_t json;
+    CHECK(_json_parse(&json, sink.data, count));
+    CHECK_EQ(json.records, count);
+    for (uint32_t i = 0; i < json.records && i < count; i++) {
+        CHECK_EQ(json.timestamps[i], readings[i].timestamp);
+        CHECK(fabs(json.temperatures[i] - readings[i].temperature) < 0.006);
+    }
+
+    // Output reassembled from chunks matches what a single unbuffered pass would produce
+    size_t expected_len = strlen("{\"history\":[") + strlen("]}");
+    char record[128];
+    for (uint32_t i = 0; i < count; i++) {
+        expected_len += snprintf(record, sizeof(record), "%s{\"temperature\":%.2f,\"humidity\":%.1f,\"timestamp\":%lld}",
+                                 i > 0 ? "," : "", readings[i].temperature, readings[i].humidity,
+                                 (long long)readings[i].timestamp);
+    }
+    CHECK_EQ(sink.len, expected_len);
+    CHECK(sink.chunks >= (sink.len + STREAM_WRITER_BUF_SIZE - 1) / STREAM_WRITER_BUF_SIZE);
+
+    _json_free(&json);
+    free(sink.data);
+    free(readings);
+}
+
+static void test_json_sizes(void) {
+    _check_json_samples(0);
+    _check_json_samples(1);
+    _check_json_samples(60);
+    _check_json_samples(10000);
+}
+
+static void test_json_buckets(void) {
+    dht11_reading_t* readings = _make_readings(10000);
+    history_query_t query     = {.from = BASE_TIME + 3600, .to = BASE_TIME + 86400, .step = 300, .format = HISTORY_FORMAT_JSON};
+    sink_t sink;
+    uint32_t num_records = 0;
+
+    CHECK_EQ(_export(readings, 10000, &query, &sink, &num_records), ESP_OK);
+    CHECK_EQ(num_records, (86400 - 3600) / 300 + 1);
+
+    json_t json;
+    CHECK(_json_parse(&json, sink.data, num_records));
+    CHECK_EQ(json.records, num_records);
+    CHECK_EQ(json.timestamps[0], BASE_TIME + 3600 - (BASE_TIME + 3600) % 300);
+    _json_free(&json);
+    free(sink.data);
+    free(readings);
+}
+
+static void test_chunk_boundary(void) {
+    // A record that does not fit the space left in the 512 byte buffer moves whole to the
+    // next chunk, so every chunk ends on a record and the joined output still parses
+    dht11_reading_t* readings = _make_readings(200);
+    history_query_t query     = {.from = 0, .to = INT32_MAX, .step = 0, .format = HISTORY_FORMAT_JSON};
+    sink_t sink;
+
+    CHECK_EQ(_export(readings, 200, &query, &sink, NULL), ESP_OK);
+    CHECK(sink.chunks > 10);
+    CHECK_EQ(sink.short_chunks, sink.chunks);
+    CHECK_EQ(sink.unaligned_chunks, 0);
+
+    json_t json;
+    CHECK(_json_parse(&json, sink.data, 200));
+    CHECK_EQ(json.records, 200);
+    _json_free(&json);
+    free(sink.data);
+    free(readings);
+
+    // Raw writes are split exactly at the buffer size
+    stream_writer_t writer;
+    char bytes[STREAM_WRITER_BUF_SIZE * 3 + 7];
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = (char)('a' + i % 26);
+    }
+    memset(&sink, 0, sizeof(sink));
+    stream_writer_init(&writer, _sink_flush, &sink);
+    CHECK_EQ(stream_writer_write(&writer, bytes, 5), ESP_OK);
+    CHECK_EQ(stream_writer_write(&writer, bytes + 5, sizeof(bytes) - 5), ESP_OK);
+    CHECK_EQ(stream_writer_flush(&writer), ESP_OK);
+    CHECK_EQ(sink.len, sizeof(bytes));
+    CHECK_EQ(sink.chunks, 4);
+    CHECK_EQ(sink.short_chunks, 1);
+    CHECK(memcmp(sink.data, bytes, sizeof(bytes)) == 0);
+    free(sink.data);
+
+    // Formatted output exactly filling the buffer is kept, one byte more can never fit
+    memset(&sink, 0, sizeof(sink));
+    stream_writer_init(&writer, _sink_flush, &sink);
+    CHECK_EQ(stream_writer_printf(&writer, "%.*s", STREAM_WRITER_BUF_SIZE - 1, bytes), ESP_OK);
+    CHECK_EQ(stream_writer_printf(&writer, "%.*s", STREAM_WRITER_BUF_SIZE, bytes), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(sink.chunks, 1);
+    CHECK_EQ(sink.len, STREAM_WRITER_BUF_SIZE - 1);
+    free(sink.data);
+}
+
+static void test_sink_error(void) {
+    // The first failed flush sticks, the export stops and reports it
+    dht11_reading_t* readings = _make_readings(10000);
+    history_query_t query     = {.from = 0, .to = INT32_MAX, .step = 0, .format = HISTORY_FORMAT_JSON};
+    source_t source           = {readings, 10000, 0};
+    sink_t sink;
+    stream_writer_t writer;
+
+    memset(&sink, 0, sizeof(sink));
+    sink.fail_after = 3;
+    stream_writer_init(&writer, _sink_flush, &sink);
+    CHECK_EQ(history_export(&writer, &query, _source_read, &source, NULL), ESP_FAIL);
+    CHECK_EQ(sink.chunks, 3);
+    CHECK(source.next < 10000);
+
+    free(sink.data);
+    free(readings);
+}
+
+int main(void) {
+    RUN_TEST(test_json_parser);
+    RUN_TEST(test_json_sizes);
+    RUN_TEST(test_json_buckets);
+    RUN_TEST(test_chunk_boundary);
+    RUN_TEST(test_sink_error);
+    return HOST_TEST_EXIT();
+}
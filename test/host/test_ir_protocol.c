@@ -0,0 +1,228 @@
+// test_ir_protocol.c
+
+#include "host_test.h"
+#include "ir_protocol.h"
+#include <string.h>
+
+// Durations as ir_capture hands them over, mark first, with the jitter of a real receiver.
+// The trailing mark after the last NEC bit is part of the capture.
+
+// NEC remote, power key
+static const uint32_t s_nec_power[] = {
+    9013, 4526,  598,  536,  597,  512,  629,  525,  574,  493,
+     591,  539,  613,  522,  624,  530,  611,  507,  630, 1617,
+     577, 1635,  579, 1678,  631, 1636,  602, 1679,  575, 1618,
+     599, 1662,  570, 1674,  620, 1686,  578,  542,  624, 1653,
+     562,  545,  607,  563,  566,  535,  566, 1671,  607,  564,
+     560,  541,  590, 1624,  631,  517,  591, 1677,  606, 1617,
+     594, 1618,  595,  514,  637, 1681,  628,
+};
+
+// NEC extended, address 0x1234 command 0x5A
+static const uint32_t s_nec_extended[] = {
+    9021, 4453,  592,  529,  604,  530,  581,  532,  572, 1683,
+     634,  524,  602,  491,  566, 1654,  562,  549,  594,  550,
+     566,  515,  599, 1643,  569, 1672,  562,  569,  632, 1677,
+     577,  541,  622,  565,  610,  513,  585, 1642,  579,  504,
+     587, 1616,  628, 1649,  600,  530,  566, 1630,  613,  501,
+     599, 1642,  611,  551,  569, 1679,  570,  559,  590,  518,
+     628, 1643,  633,  510,  597, 1616,  622,
+};
+
+// Sent every 110 ms while the NEC key is held
+static const uint32_t s_nec_repeat[] = {
+    9030, 2240,  622,
+};
+
+// Samsung TV power, address 0xE0 sent twice
+static const uint32_t s_samsung_power[] = {
+    4436, 4561,  612, 1676,  640, 1666,  569, 1668,  587,  519,
+     621,  530,  584,  536,  636,  493,  633,  562,  626, 1664,
+     566, 1652,  634, 1631,  631,  519,  638,  530,  607,  512,
+     587,  528,  615,  535,  617,  565,  571, 1676,  573,  556,
+     561,  514,  633,  560,  582,  547,  619,  547,  624,  507,
+     628, 1680,  620,  547,  561, 1647,  593, 1633,  561, 1669,
+     603, 1652,  587, 1616,  594, 1622,  626,
+};
+
+// RC5 address 5 command 0x21, two presses of the same key. The leading idle half
+// of the start bit is never captured.
+static const uint32_t s_rc5_toggle_1[] = {
+     924,  928,  840,  842, 1742,  899,  929, 1766, 1806, 1754,
+     938,  851, 1827,  842,  897,  907,  936,  867,  922, 1731,
+     890,
+};
+
+static const uint32_t s_rc5_toggle_0[] = {
+     854,  893, 1735,  933,  908,  846,  863, 1796, 1761, 1762,
+     884,  883, 1797,  913,  892,  890,  839,  906,  935, 1771,
+     849,
+};
+
+// RC5X address 0 command 0x41
+static const uint32_t s_rc5x[] = {
+    1824,  934,  843,  919,  932,  875,  880,  880,  854,  881,
+     855,  907,  870,  902,  875,  895,  854,  871,  870,  848,
+     926,  892,  878, 1815,  864,
+};
+
+#define LEN(array) (sizeof(array) / sizeof(array[0]))
+
+static ir_frame_t decode(const uint32_t* durations, size_t len) {
+    ir_frame_t frame;
+    memset(&frame, 0xA5, sizeof(frame));
+    ir_protocol_decode(durations, len, &frame);
+    return frame;
+}
+
+static void test_nec(void) {
+    ir_frame_t frame = decode(s_nec_power, LEN(s_nec_power));
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_NEC);
+    CHECK_EQ(frame.address, 0x00);
+    CHECK_EQ(frame.command, 0xA2);
+
+    frame = decode(s_nec_extended, LEN(s_nec_extended));
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_NEC_EXTENDED);
+    CHECK_EQ(frame.address, 0x1234);
+    CHECK_EQ(frame.command, 0x5A);
+}
+
+static void test_nec_repeat(void) {
+    ir_frame_t frame = decode(s_nec_repeat, LEN(s_nec_repeat));
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_REPEAT);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_NEC);
+}
+
+static void test_nec_bad_command(void) {
+    uint32_t durations[LEN(s_nec_power)];
+    memcpy(durations, s_nec_power, sizeof(durations));
+
+    // Last bit of the inverted command, a one read as a zero
+    durations[LEN(durations) - 2] = NEC_ZERO_SPACE;
+    ir_frame_t frame = decode(durations, LEN(durations));
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_NEC);
+}
+
+static void test_samsung(void) {
+    ir_frame_t frame = decode(s_samsung_power, LEN(s_samsung_power));
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_SAMSUNG);
+    CHECK_EQ(frame.address, 0xE0);
+    CHECK_EQ(frame.command, 0x40);
+}
+
+static void test_rc5(void) {
+    ir_frame_t first  = decode(s_rc5_toggle_1, LEN(s_rc5_toggle_1));
+    ir_frame_t second = decode(s_rc5_toggle_0, LEN(s_rc5_toggle_0));
+
+    CHECK_EQ(first.type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(first.protocol, IR_PROTOCOL_RC5);
+    CHECK_EQ(first.address, 5);
+    CHECK_EQ(first.command, 0x21);
+    CHECK_EQ(first.toggle, 1);
+
+    // Same key pressed again, only the toggle differs
+    CHECK_EQ(second.type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(second.address, 5);
+    CHECK_EQ(second.command, 0x21);
+    CHECK_EQ(second.toggle, 0);
+}
+
+static void test_rc5x(void) {
+    // S2 cleared, the leading mark spans the second half of S1 and the first of S2
+    ir_frame_t frame = decode(s_rc5x, LEN(s_rc5x));
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_RC5);
+    CHECK_EQ(frame.address, 0);
+    CHECK_EQ(frame.command, 0x41);
+    CHECK_EQ(frame.toggle, 0);
+}
+
+// Sets one duration of the NEC power frame and decodes it
+static ir_frame_t decode_nec_with(size_t index, uint32_t duration) {
+    uint32_t durations[LEN(s_nec_power)];
+    memcpy(durations, s_nec_power, sizeof(durations));
+    durations[index] = duration;
+    return decode(durations, LEN(durations));
+}
+
+static void test_tolerance_edges(void) {
+    // IR_TOLERANCE_PERCENT either side of the nominal duration is still a match
+    uint32_t lead_slack = NEC_START_PULSE * IR_TOLERANCE_PERCENT / 100;
+    CHECK_EQ(decode_nec_with(0, NEC_START_PULSE - lead_slack).type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(decode_nec_with(0, NEC_START_PULSE + lead_slack).type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(decode_nec_with(0, NEC_START_PULSE - lead_slack - 1).protocol, IR_PROTOCOL_UNKNOWN);
+    CHECK_EQ(decode_nec_with(0, NEC_START_PULSE + lead_slack + 1).protocol, IR_PROTOCOL_UNKNOWN);
+
+    // First bit mark
+    uint32_t mark_slack = NEC_BIT_PULSE * IR_TOLERANCE_PERCENT / 100;
+    CHECK_EQ(decode_nec_with(2, NEC_BIT_PULSE - mark_slack).type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(decode_nec_with(2, NEC_BIT_PULSE + mark_slack).type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(decode_nec_with(2, NEC_BIT_PULSE - mark_slack - 1).type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(decode_nec_with(2, NEC_BIT_PULSE + mark_slack + 1).type, IR_FRAME_TYPE_INVALID);
+
+    // Index 19 is the space of the first one bit (address inverse, bit 23). A space
+    // between the zero and one windows is neither.
+    uint32_t one_slack  = NEC_ONE_SPACE * IR_TOLERANCE_PERCENT / 100;
+    uint32_t zero_slack = NEC_ZERO_SPACE * IR_TOLERANCE_PERCENT / 100;
+    CHECK_EQ(decode_nec_with(19, NEC_ONE_SPACE - one_slack).type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(decode_nec_with(19, NEC_ONE_SPACE + one_slack).type, IR_FRAME_TYPE_DATA);
+    CHECK_EQ(decode_nec_with(19, NEC_ZERO_SPACE + zero_slack + 1).type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(decode_nec_with(19, NEC_ONE_SPACE - one_slack - 1).type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(decode_nec_with(19, NEC_ONE_SPACE + one_slack + 1).type, IR_FRAME_TYPE_INVALID);
+
+    // RC5 half bits share the same tolerance
+    uint32_t durations[LEN(s_rc5_toggle_1)];
+    memcpy(durations, s_rc5_toggle_1, sizeof(durations));
+    uint32_t half_slack = RC5_HALF_BIT * IR_TOLERANCE_PERCENT / 100;
+
+    durations[1] = RC5_HALF_BIT + half_slack;
+    CHECK_EQ(decode(durations, LEN(durations)).type, IR_FRAME_TYPE_DATA);
+    durations[1] = RC5_HALF_BIT + half_slack + 1;
+    CHECK_EQ(decode(durations, LEN(durations)).type, IR_FRAME_TYPE_INVALID);
+}
+
+static void test_truncated_frame(void) {
+    // The capture stopped after 20 of the 32 NEC bits, the leader still claims it
+    ir_frame_t frame = decode(s_nec_power, 2 + 20 * 2);
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_NEC);
+
+    frame = decode(s_rc5_toggle_1, LEN(s_rc5_toggle_1) - 4);
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_RC5);
+
+    frame = decode(s_nec_power, 1);
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_UNKNOWN);
+
+    frame = decode(s_nec_power, 0);
+    CHECK_EQ(frame.type, IR_FRAME_TYPE_INVALID);
+    CHECK_EQ(frame.protocol, IR_PROTOCOL_UNKNOWN);
+    CHECK_EQ(frame.address, 0);
+    CHECK_EQ(frame.command, 0);
+}
+
+static void test_names(void) {
+    CHECK(strcmp(ir_protocol_name(IR_PROTOCOL_NEC), "NEC") == 0);
+    CHECK(strcmp(ir_protocol_name(IR_PROTOCOL_NEC_EXTENDED), "NEC extended") == 0);
+    CHECK(strcmp(ir_protocol_name(IR_PROTOCOL_SAMSUNG), "Samsung") == 0);
+    CHECK(strcmp(ir_protocol_name(IR_PROTOCOL_RC5), "RC5") == 0);
+    CHECK(strcmp(ir_protocol_name(IR_PROTOCOL_UNKNOWN), "unknown") == 0);
+}
+
+int main(void) {
+    RUN_TEST(test_nec);
+    RUN_TEST(test_nec_repeat);
+    RUN_TEST(test_nec_bad_command);
+    RUN_TEST(test_samsung);
+    RUN_TEST(test_rc5);
+    RUN_TEST(test_rc5x);
+    RUN_TEST(test_tolerance_edges);
+    RUN_TEST(test_truncated_frame);
+    RUN_TEST(test_names);
+    return HOST_TEST_EXIT();
+}
@@ -0,0 +1,344 @@
+// test_lcd_flush.c
+
+#include "host_clock.h"
+#include "host_test.h"
+#include "lcd_i2c.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Fake bus: every transmit is counted and fed to a model of the PCF8574 backpack and the
+// HD44780 behind it, so tests can check both the traffic and what ends up on the glass.
+// Bytes take their bus time on the simulated clock, and a nibble latched while the
+// controller is still executing the last instruction is lost, as on the real part.
+typedef struct {
+    uint32_t scl_hz;
+    uint32_t transactions;
+    uint32_t bytes;
+    esp_err_t fail_with;
+
+    uint64_t busy_until_ns;
+    uint32_t busy_violations;
+    uint32_t init_latches;
+
+    uint8_t last_pins;
+    bool four_bit;
+    bool have_high_nibble;
+    uint8_t high_nibble;
+    bool cgram_mode;
+    uint8_t addr;
+    char ddram[0x80];
+    uint8_t cgram[64];
+} fake_lcd_t;
+
+static fake_lcd_t s_fake;
+static i2cbus_device_t s_device;
+
+esp_err_t i2cbus_attach(const i2cbus_device_config_t* config, i2cbus_device_t** device) {
+    memset(&s_device, 0, sizeof(s_device));
+    s_device.config = *config;
+    *device         = &s_device;
+    return ESP_OK;
+}
+
+esp_err_t i2cbus_negotiate(i2cbus_device_t* device) {
+    (void)device;
+    return ESP_OK;
+}
+
+uint32_t i2cbus_speed(const i2cbus_device_t* device) {
+    (void)device;
+    return s_fake.scl_hz;
+}
+
+// Datasheet execution times, the slowest of the parts in circulation
+#define HD44780_POWER_ON_US  40000
+#define HD44780_EXEC_US      37
+#define HD44780_CLEAR_US     1520
+
+static void _fake_lcd_busy(uint32_t us) {
+    s_fake.busy_until_ns = host_clock_ns + (uint64_t)us * 1000;
+}
+
+static void _fake_lcd_execute(uint8_t value, bool data) {
+    bool slow = !data && value <= (LCD_RETURNHOME | 1);
+    _fake_lcd_busy(slow ? HD44780_CLEAR_US : HD44780_EXEC_US);
+
+    if (data) {
+        if (s_fake.cgram_mode) {
+            s_fake.cgram[s_fake.addr & 0x3F] = value;
+            s_fake.addr = (s_fake.addr + 1) & 0x3F;
+        } else {
+            s_fake.ddram[s_fake.addr & 0x7F] = (char)value;
+            s_fake.addr = (s_fake.addr + 1) & 0x7F;
+        }
+        return;
+    }
+
+    if (value & LCD_SETDDRAMADDR) {
+        s_fake.cgram_mode = false;
+        s_fake.addr       = value & 0x7F;
+    } else if (value & LCD_SETCGRAMADDR) {
+        s_fake.cgram_mode = true;
+        s_fake.addr       = value & 0x3F;
+    } else if (value == LCD_CLEARDISPLAY) {
+        memset(s_fake.ddram, ' ', sizeof(s_fake.ddram));
+        s_fake.cgram_mode = false;
+        s_fake.addr       = 0;
+    } else if ((value & 0xFE) == LCD_RETURNHOME) {
+        s_fake.cgram_mode = false;
+        s_fake.addr       = 0;
+    }
+}
+
+// The HD44780 latches D4-D7 on the falling edge of EN. It starts in 8-bit mode where
+// each latch is a whole command, until function set switches it to 4 bits.
+static void _fake_lcd_pins(uint8_t pins) {
+    bool falling      = (s_fake.last_pins & PCF8574_EN) && !(pins & PCF8574_EN);
+    s_fake.last_pins  = pins;
+    if (!falling) {
+        return;
+    }
+
+    if (host_clock_ns < s_fake.busy_until_ns) {
+        s_fake.busy_violations++;
+        return;
+    }
+
+    uint8_t nibble = pins >> 4;
+    bool data      = (pins & PCF8574_RS) != 0;
+
+    if (!s_fake.four_bit) {
+        // The reset sequence needs 4.1 ms after the first latch and 100 us after the second
+        s_fake.init_latches++;
+        _fake_lcd_busy(s_fake.init_latches == 1 ? 4100 : s_fake.init_latches == 2 ? 100 : HD44780_EXEC_US);
+        if ((nibble << 4 & 0xF0) == LCD_FUNCTIONSET) {
+            s_fake.four_bit         = true;
+            s_fake.have_high_nibble = false;
+        }
+        return;
+    }
+
+    if (!s_fake.have_high_nibble) {
+        s_fake.high_nibble      = nibble;
+        s_fake.have_high_nibble = true;
+        return;
+    }
+    s_fake.have_high_nibble = false;
+    _fake_lcd_execute((uint8_t)(s_fake.high_nibble << 4 | nibble), data);
+}
+
+esp_err_t i2cbus_transmit(i2cbus_device_t* device, const uint8_t* data, size_t len, int timeout_ms) {
+    (void)device;
+    (void)timeout_ms;
+    if (s_fake.fail_with != ESP_OK) {
+        return s_fake.fail_with;
+    }
+    s_fake.transactions++;
+    s_fake.bytes += len;
+
+    // Start and address byte, then each byte reaches the pins as its ACK is clocked
+    uint64_t byte_ns = 9 * (1000000000ull / s_fake.scl_hz);
+    host_clock_ns += byte_ns;
+    for (size_t i = 0; i < len; i++) {
+        host_clock_ns += byte_ns;
+        _fake_lcd_pins(data[i]);
+    }
+    return ESP_OK;
+}
+
+static lcd_i2c_handle_t* _init_lcd(uint32_t scl_hz) {
+    memset(&s_fake, 0, sizeof(s_fake));
+    memset(s_fake.ddram, '#', sizeof(s_fake.ddram));
+    s_fake.scl_hz = scl_hz;
+
+    // Powered up just now
+    host_clock_ns        = 0;
+    s_fake.busy_until_ns = (uint64_t)HD44780_POWER_ON_US * 1000;
+
+    lcd_i2c_handle_t* lcd = lcd_i2c_init();
+    CHECK(lcd != NULL && lcd->ready);
+    CHECK_EQ(s_fake.busy_violations, 0);
+    return lcd;
+}
+
+static void _reset_counters(void) {
+    s_fake.transactions = 0;
+    s_fake.bytes        = 0;
+}
+
+static void _check_glass(const lcd_frame_t* frame) {
+    CHECK_EQ(s_fake.busy_violations, 0);
+    CHECK(memcmp(&s_fake.ddram[0x00], frame->text[0], LCD_COLS) == 0);
+    CHECK(memcmp(&s_fake.ddram[0x40], frame->text[1], LCD_COLS) == 0);
+}
+
+static void _fill_frame(lcd_frame_t* frame) {
+    lcd_frame_clear(frame);
+    lcd_frame_printf(frame, 0, 0, "Temp:  72.50 F  ");
+    lcd_frame_printf(frame, 0, 1, "Humidity: 45.0 %%");
+}
+
+// Each character or command is two nibbles, each nibble an EN high and an EN low byte
+#define BYTES_PER_WRITE 4
+
+static void test_init_clears_glass(void) {
+    lcd_i2c_handle_t* lcd = _init_lcd(100000);
+    lcd_frame_t frame;
+    lcd_frame_clear(&frame);
+    _check_glass(&frame);
+    CHECK(s_fake.four_bit);
+    CHECK(s_fake.last_pins & PCF8574_BL);
+    free(lcd);
+}
+
+static void test_one_char_vs_full_redraw(void) {
+    lcd_i2c_handle_t* lcd = _init_lcd(100000);
+    lcd_frame_t frame;
+    _fill_frame(&frame);
+
+    // After init the glass is blank, so only the non-blank characters are sent
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    uint32_t first_bytes = s_fake.bytes;
+    CHECK_EQ(s_fake.transactions, 1);
+
+    // Unknown glass forces a full redraw: a cursor move and 16 characters per row
+    memset(lcd->shadow, LCD_SHADOW_INVALID, sizeof(lcd->shadow));
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    uint32_t full_bytes = s_fake.bytes;
+    CHECK_EQ(full_bytes, LCD_ROWS * (1 + LCD_COLS) * BYTES_PER_WRITE);
+    CHECK_EQ(s_fake.transactions, 1);
+    CHECK(first_bytes <= full_bytes);
+
+    // One changed digit is a cursor move and one character
+    frame.text[0][10] = '1';
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    uint32_t one_bytes = s_fake.bytes;
+    CHECK_EQ(one_bytes, 2 * BYTES_PER_WRITE);
+    CHECK_EQ(s_fake.transactions, 1);
+
+    // An unchanged frame puts nothing on the bus
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    CHECK_EQ(s_fake.bytes, 0);
+    CHECK_EQ(s_fake.transactions, 0);
+
+    printf("full redraw %u bytes, one character %u bytes\n", (unsigned)full_bytes, (unsigned)one_bytes);
+    free(lcd);
+}
+
+static void test_adjacent_runs_merge(void) {
+    lcd_i2c_handle_t* lcd = _init_lcd(100000);
+    lcd_frame_t frame;
+    _fill_frame(&frame);
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+
+    // Cells 7 and 9 change, rewriting the unchanged 8 costs the same as a second cursor move
+    frame.text[0][7] = '8';
+    frame.text[0][9] = '9';
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    CHECK_EQ(s_fake.bytes, 4 * BYTES_PER_WRITE);
+
+    // Both rows change, still one write on the bus
+    frame.text[0][0] = 't';
+    frame.text[1][0] = 'h';
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    CHECK_EQ(s_fake.transactions, 1);
+    CHECK_EQ(s_fake.bytes, 4 * BYTES_PER_WRITE);
+    free(lcd);
+}
+
+static void test_exec_padding(void) {
+    // At 400 kHz a byte is 22.5 us, two idle bytes cover the 50 us execution time
+    lcd_i2c_handle_t* lcd = _init_lcd(400000);
+    lcd_frame_t frame;
+    _fill_frame(&frame);
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+
+    frame.text[0][10] = '1';
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    CHECK_EQ(s_fake.bytes, 2 * (BYTES_PER_WRITE + 2));
+    free(lcd);
+}
+
+static void test_glyph_reuse(void) {
+    static const lcd_glyph_t degree = {{0x06, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00, 0x00}};
+    lcd_i2c_handle_t* lcd = _init_lcd(100000);
+    lcd_frame_t frame;
+
+    _fill_frame(&frame);
+    frame.text[0][13] = lcd_frame_glyph(&frame, &degree);
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    CHECK(memcmp(s_fake.cgram, degree.rows, sizeof(degree.rows)) == 0);
+
+    // Same glyph next frame: no CGRAM upload, only the changed digit
+    _fill_frame(&frame);
+    frame.text[0][13] = lcd_frame_glyph(&frame, &degree);
+    frame.text[0][10] = '1';
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    CHECK_EQ(s_fake.bytes, 2 * BYTES_PER_WRITE);
+    free(lcd);
+}
+
+static void test_clear_busy_time(void) {
+    lcd_i2c_handle_t* lcd = _init_lcd(400000);
+    lcd_frame_t frame;
+    _fill_frame(&frame);
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+
+    // The cursor move right after a clear or home lands while the controller is still
+    // busy unless the driver waits it out
+    CHECK_EQ(lcd_i2c_clear(lcd), ESP_OK);
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+
+    CHECK_EQ(lcd_i2c_home(lcd), ESP_OK);
+    frame.text[0][0] = 'X';
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    free(lcd);
+}
+
+static void test_failed_write_redraws(void) {
+    lcd_i2c_handle_t* lcd = _init_lcd(100000);
+    lcd_frame_t frame;
+    _fill_frame(&frame);
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+
+    frame.text[0][10] = '1';
+    s_fake.fail_with  = ESP_ERR_TIMEOUT;
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_ERR_TIMEOUT);
+
+    // The glass may hold anything now, the next flush rewrites every cell
+    s_fake.fail_with = ESP_OK;
+    _reset_counters();
+    CHECK_EQ(lcd_i2c_flush(lcd, &frame), ESP_OK);
+    _check_glass(&frame);
+    CHECK_EQ(s_fake.bytes, LCD_ROWS * (1 + LCD_COLS) * BYTES_PER_WRITE);
+    free(lcd);
+}
+
+int main(void) {
+    RUN_TEST(test_init_clears_glass);
+    RUN_TEST(test_one_char_vs_full_redraw);
+    RUN_TEST(test_adjacent_runs_merge);
+    RUN_TEST(test_exec_padding);
+    RUN_TEST(test_glyph_reuse);
+    RUN_TEST(test_clear_busy_time);
+    RUN_TEST(test_failed_write_redraws);
+    return HOST_TEST_EXIT();
+}